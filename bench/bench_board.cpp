@@ -0,0 +1,81 @@
+/////////////////////////////////////////////////////////////////////////
+/// BouncingBallsSolver
+/// Copyright (C) 2014 Jérôme Béchu
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////
+
+#include <cmath>
+
+#include <benchmark/benchmark.h>
+
+#include "fixtures.h"
+
+namespace
+{
+
+// grid, drops, groups and scores of every ball
+void BM_Rearange(benchmark::State & state)
+{
+  bbs::Board board;
+  bench::fillBoard(board, state.range(0), 42);
+  for(auto _ : state)
+    board.rearange();
+  state.counters["balls"] = board.count_ball();
+}
+BENCHMARK(BM_Rearange)->Arg(3)->Arg(6)->Arg(9)->Arg(12)->Arg(50)->Arg(200);
+
+// balls around points all over the board
+void BM_Find(benchmark::State & state)
+{
+  bbs::Board board;
+  bench::fillBoard(board, state.range(0), 42);
+  std::vector<cv::Point> targets;
+  for(int y=0;y<board.height;y+=7)
+  {
+    for(int x=0;x<board.width;x+=11)
+      targets.push_back(cv::Point(x, y));
+  }
+  std::vector<bbs::Board::Ball*> balls;
+  int i = 0;
+  for(auto _ : state)
+  {
+    balls.clear();
+    benchmark::DoNotOptimize(board.find(targets[i], balls));
+    i = (i + 1) % targets.size();
+  }
+}
+BENCHMARK(BM_Find)->Arg(3)->Arg(6)->Arg(9)->Arg(12)->Arg(50)->Arg(200);
+
+// the collision test of the solver : shots from the player
+// across the board
+void BM_Cast(benchmark::State & state)
+{
+  bbs::Board board;
+  bench::fillBoard(board, state.range(0), 42);
+  std::vector<cv::Point2f> directions;
+  for(float angle=-M_PI+0.2;angle<-0.2;angle+=0.01)
+    directions.push_back(cv::Point2f(std::cos(angle), std::sin(angle)));
+  cv::Point2f origin = board.player.point;
+  int i = 0;
+  for(auto _ : state)
+  {
+    float t;
+    benchmark::DoNotOptimize(board.cast(origin, directions[i], board.height, t));
+    i = (i + 1) % directions.size();
+  }
+}
+BENCHMARK(BM_Cast)->Arg(3)->Arg(6)->Arg(9)->Arg(12)->Arg(50)->Arg(200);
+
+}
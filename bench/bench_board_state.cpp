@@ -0,0 +1,101 @@
+/////////////////////////////////////////////////////////////////////////
+/// BouncingBallsSolver
+/// Copyright (C) 2014 Jérôme Béchu
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////
+
+#include <benchmark/benchmark.h>
+
+#include "board_state.h"
+#include "fixtures.h"
+
+namespace
+{
+
+std::vector<std::pair<int, int> > openCells(bbs::BoardState const& root)
+{
+  std::vector<std::pair<int, int> > cells;
+  bbs::BoardState::RowMask open[bbs::BoardState::kRows];
+  root.open(open);
+  for(int r=0;r<root.rows();++r)
+  {
+    for(int c=0;c<root.cols();++c)
+    {
+      if(open[r] >> c & 1)
+        cells.push_back(std::make_pair(r, c));
+    }
+  }
+  return cells;
+}
+
+// a copy is what every simulated shot starts with
+void BM_BoardStateCopy(benchmark::State & state)
+{
+  bbs::Board board;
+  bench::fillBoard(board, state.range(0), 42);
+  bbs::BoardState root;
+  board.exportState(root);
+
+  bbs::BoardState copy;
+  for(auto _ : state)
+  {
+    copy = root;
+    benchmark::DoNotOptimize(&copy);
+  }
+}
+BENCHMARK(BM_BoardStateCopy)->Arg(6)->Arg(9);
+
+// a copy, then a shot on every open cell in turn (pop and drop)
+void BM_BoardStatePlace(benchmark::State & state)
+{
+  bbs::Board board;
+  bench::fillBoard(board, state.range(0), 42);
+  bbs::BoardState root;
+  board.exportState(root);
+
+  std::vector<std::pair<int, int> > cells = openCells(root);
+
+  bbs::BoardState next;
+  int i = 0;
+  for(auto _ : state)
+  {
+    next = root;
+    benchmark::DoNotOptimize(next.place(cells[i].first, cells[i].second, 1 + i % 4));
+    i = (i + 1) % cells.size();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BoardStatePlace)->Arg(6)->Arg(9);
+
+// the same shots only scored (no copy), as the lookahead leaves
+void BM_BoardStateRemoved(benchmark::State & state)
+{
+  bbs::Board board;
+  bench::fillBoard(board, state.range(0), 42);
+  bbs::BoardState root;
+  board.exportState(root);
+  std::vector<std::pair<int, int> > cells = openCells(root);
+
+  int i = 0;
+  for(auto _ : state)
+  {
+    benchmark::DoNotOptimize(root.removed(cells[i].first, cells[i].second, 1 + i % 4));
+    i = (i + 1) % cells.size();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BoardStateRemoved)->Arg(6)->Arg(9);
+
+}
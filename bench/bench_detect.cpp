@@ -0,0 +1,150 @@
+/////////////////////////////////////////////////////////////////////////
+/// BouncingBallsSolver
+/// Copyright (C) 2014 Jérôme Béchu
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////
+
+#include <benchmark/benchmark.h>
+
+#include "detect_board.h"
+#include "detect_game.h"
+#include "fixtures.h"
+
+namespace
+{
+
+///! size of the synthetic desktop
+const int kScreenWidth = 1280;
+const int kScreenHeight = 800;
+
+////////////////////////////////////////////////////////////
+/// @brief a desktop of noise with the motif at (300, 200)
+////////////////////////////////////////////////////////////
+bool screenshot(cv::Mat & screen, bbs::DetectGame & detector)
+{
+  std::string motif = std::string(BBS_SOURCE_DIR) + "/motif.png";
+  cv::Mat tmpl = cv::imread(motif);
+  if(!detector.setMotif(tmpl))
+    return false;
+  screen.create(kScreenHeight, kScreenWidth, CV_8UC3);
+  cv::theRNG().fill(screen, cv::RNG::UNIFORM, 0, 256);
+  cv::Mat game = screen(cv::Rect(300, 200, tmpl.cols, tmpl.rows));
+  tmpl.copyTo(game);
+  return true;
+}
+
+// the game did not move, the last match is checked first
+void BM_DetectGameTracked(benchmark::State & state)
+{
+  bbs::DetectGame detector;
+  cv::Mat screen;
+  if(!screenshot(screen, detector))
+  {
+    state.SkipWithError("motif.png not found");
+    return ;
+  }
+  detector.run(screen);
+  for(auto _ : state)
+    benchmark::DoNotOptimize(detector.run(screen));
+}
+BENCHMARK(BM_DetectGameTracked);
+
+// the first search (coarse to fine)
+void BM_DetectGameSearch(benchmark::State & state)
+{
+  bbs::DetectGame detector;
+  cv::Mat screen;
+  if(!screenshot(screen, detector))
+  {
+    state.SkipWithError("motif.png not found");
+    return ;
+  }
+  for(auto _ : state)
+  {
+    detector.reset();
+    benchmark::DoNotOptimize(detector.run(screen));
+  }
+}
+BENCHMARK(BM_DetectGameSearch)->Unit(benchmark::kMillisecond);
+
+// a new game each time : first ball search, rows walk
+void BM_DetectBoardSearch(benchmark::State & state)
+{
+  cv::Mat frame = bench::renderBoard(state.range(0), 42);
+  bbs::DetectBoard detector;
+  bbs::Board board;
+  for(auto _ : state)
+  {
+    detector.reset();
+    benchmark::DoNotOptimize(detector.run(frame, board));
+  }
+  state.counters["balls"] = board.count_ball();
+}
+BENCHMARK(BM_DetectBoardSearch)->Arg(3)->Arg(6)->Arg(9)->Arg(12)->Arg(50)->Arg(200);
+
+// the grid geometry is known : a few probes, rows walk
+void BM_DetectBoardCached(benchmark::State & state)
+{
+  cv::Mat frame = bench::renderBoard(state.range(0), 42);
+  bbs::DetectBoard detector;
+  bbs::Board board;
+  detector.run(frame, board);
+  for(auto _ : state)
+    benchmark::DoNotOptimize(detector.run(frame, board));
+  state.counters["balls"] = board.count_ball();
+}
+BENCHMARK(BM_DetectBoardCached)->Arg(3)->Arg(6)->Arg(9)->Arg(12)->Arg(50)->Arg(200);
+
+// steady state of the incremental update : only the probes
+void BM_DetectBoardIncremental(benchmark::State & state)
+{
+  cv::Mat frame = bench::renderBoard(state.range(0), 42);
+  bbs::DetectBoard detector;
+  detector.setPalette(true);
+  detector.setIncremental(true);
+  bbs::Board board;
+  detector.run(frame, board);
+  for(auto _ : state)
+    benchmark::DoNotOptimize(detector.run(frame, board));
+  state.counters["balls"] = board.count_ball();
+}
+BENCHMARK(BM_DetectBoardIncremental)->Arg(3)->Arg(6)->Arg(9)->Arg(12);
+
+// recorded frames in turn, with the settings of the live game
+void BM_DetectBoardRecorded(benchmark::State & state)
+{
+  std::vector<cv::Mat> frames;
+  if(!bench::recordedFrames(frames))
+  {
+    state.SkipWithError("BBS_BENCH_FRAMES is not a directory of frames");
+    return ;
+  }
+  bbs::DetectBoard detector;
+  detector.setPalette(true);
+  detector.setGate(true);
+  detector.setIncremental(true);
+  bbs::Board board;
+  int i = 0;
+  for(auto _ : state)
+  {
+    if(!detector.run(frames[i], board))
+      detector.reset();
+    i = (i + 1) % frames.size();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DetectBoardRecorded);
+
+}
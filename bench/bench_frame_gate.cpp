@@ -0,0 +1,47 @@
+/////////////////////////////////////////////////////////////////////////
+/// BouncingBallsSolver
+/// Copyright (C) 2014 Jérôme Béchu
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////
+
+#include <benchmark/benchmark.h>
+
+#include "frame_gate.h"
+
+namespace
+{
+
+///! size of the game area
+const int kGameWidth = 420;
+const int kGameHeight = 290;
+
+// a static board : every row is compared, nothing changed
+void BM_FrameGateStatic(benchmark::State & state)
+{
+  cv::Mat hue(kGameHeight, kGameWidth, CV_8UC1);
+  cv::theRNG().fill(hue, cv::RNG::UNIFORM, 0, 180);
+  bbs::FrameGate gate;
+  gate.update(hue);
+  gate.accept();
+  for(auto _ : state)
+  {
+    bool changed = gate.update(hue);
+    benchmark::DoNotOptimize(changed);
+  }
+  state.SetItemsProcessed(state.iterations() * kGameWidth * kGameHeight);
+}
+BENCHMARK(BM_FrameGateStatic);
+
+}
@@ -0,0 +1,71 @@
+/////////////////////////////////////////////////////////////////////////
+/// BouncingBallsSolver
+/// Copyright (C) 2014 Jérôme Béchu
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////
+
+#include <benchmark/benchmark.h>
+
+#include "color_conversion.h"
+
+namespace
+{
+
+///! size of the game area
+const int kGameWidth = 420;
+const int kGameHeight = 290;
+
+////////////////////////////////////////////////////////////
+/// @brief a raw X11 frame (BGRX) filled with noise
+////////////////////////////////////////////////////////////
+cv::Mat rawFrame()
+{
+  cv::Mat frame(kGameHeight, kGameWidth, CV_8UC4);
+  cv::theRNG().fill(frame, cv::RNG::UNIFORM, 0, 256);
+  return frame;
+}
+
+// the historical path : drop X, full hsv conversion, keep hue
+void BM_CvtColorSplit(benchmark::State & state)
+{
+  cv::Mat frame = rawFrame();
+  for(auto _ : state)
+  {
+    cv::Mat bgr;
+    cv::cvtColor(frame, bgr, CV_BGRA2BGR);
+    cv::Mat out(bgr.size(), CV_8UC3);
+    cv::cvtColor(bgr, out, CV_RGB2HSV);
+    std::vector<cv::Mat> channel;
+    cv::split(out, channel);
+    benchmark::DoNotOptimize(channel[0].data);
+  }
+  state.SetItemsProcessed(state.iterations() * kGameWidth * kGameHeight);
+}
+BENCHMARK(BM_CvtColorSplit);
+
+void BM_ToHue(benchmark::State & state)
+{
+  cv::Mat frame = rawFrame();
+  cv::Mat hue;
+  for(auto _ : state)
+  {
+    bbs::toHue(frame, hue);
+    benchmark::DoNotOptimize(hue.data);
+  }
+  state.SetItemsProcessed(state.iterations() * kGameWidth * kGameHeight);
+}
+BENCHMARK(BM_ToHue);
+
+}
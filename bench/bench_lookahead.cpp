@@ -0,0 +1,57 @@
+/////////////////////////////////////////////////////////////////////////
+/// BouncingBallsSolver
+/// Copyright (C) 2014 Jérôme Béchu
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////
+
+#include <benchmark/benchmark.h>
+
+#include "fixtures.h"
+#include "lookahead.h"
+
+namespace
+{
+
+// one frame of the lookahead search, the budget is the limit
+void BM_Lookahead(benchmark::State & state)
+{
+  bbs::Board board;
+  bench::fillBoard(board, state.range(0), 42);
+  bbs::Solver solver(1);
+  bbs::Lookahead lookahead(solver);
+  bbs::Lookahead::Settings settings;
+  settings.depth = state.range(1);
+  settings.budget = 1;
+  // the same board each time, measure a cold search
+  settings.table = 0;
+  settings.decisions = 0;
+  lookahead.setSettings(settings);
+
+  int depth = 0;
+  int nodes = 0;
+  for(auto _ : state)
+  {
+    bbs::Solver::Solution solution = lookahead.run(board);
+    benchmark::DoNotOptimize(solution.angle);
+    depth = lookahead.depth();
+    nodes = lookahead.nodes();
+  }
+  state.counters["depth"] = depth;
+  state.counters["nodes"] = nodes;
+}
+BENCHMARK(BM_Lookahead)->Args({6, 1})->Args({6, 2})->Args({6, 3})
+                       ->Args({9, 2})->Unit(benchmark::kMillisecond);
+
+}
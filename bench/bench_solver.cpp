@@ -0,0 +1,117 @@
+/////////////////////////////////////////////////////////////////////////
+/// BouncingBallsSolver
+/// Copyright (C) 2014 Jérôme Béchu
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////
+
+#include <benchmark/benchmark.h>
+
+#include "detect_board.h"
+#include "fixtures.h"
+#include "solver.h"
+
+namespace
+{
+
+void runSolver(benchmark::State & state, bool adaptive)
+{
+  bbs::Board board;
+  bench::fillBoard(board, state.range(0), 42);
+  bbs::Solver solver(1);
+  bbs::Solver::Search search;
+  search.adaptive = adaptive;
+  solver.setSearch(search);
+  // the same board each time, measure the search
+  solver.setCacheSize(0);
+
+  int angles = 0;
+  for(auto _ : state)
+  {
+    bbs::Solver::Solution solution = solver.run(board);
+    benchmark::DoNotOptimize(solution.angle);
+    angles = solver.evaluated();
+  }
+  state.counters["angles"] = angles;
+}
+
+// the fixed kOffsetAngle sweep
+void BM_SolverSweep(benchmark::State & state)
+{
+  runSolver(state, false);
+}
+BENCHMARK(BM_SolverSweep)->Arg(3)->Arg(6)->Arg(9)->Arg(12)->Arg(50)->Arg(200);
+
+// coarse sweep, then bisection where the score changes
+void BM_SolverAdaptive(benchmark::State & state)
+{
+  runSolver(state, true);
+}
+BENCHMARK(BM_SolverAdaptive)->Arg(3)->Arg(6)->Arg(9)->Arg(12);
+
+// a board already solved (hash and cache lookup)
+void BM_SolverCached(benchmark::State & state)
+{
+  bbs::Board board;
+  bench::fillBoard(board, state.range(0), 42);
+  bbs::Solver solver(1);
+  solver.run(board);
+
+  for(auto _ : state)
+  {
+    bbs::Solver::Solution solution = solver.run(board);
+    benchmark::DoNotOptimize(solution.angle);
+  }
+  state.counters["hits"] = solver.cache().hits();
+}
+BENCHMARK(BM_SolverCached)->Arg(3)->Arg(6)->Arg(9);
+
+// the boards of recorded frames in turn
+void BM_SolverRecorded(benchmark::State & state)
+{
+  std::vector<cv::Mat> frames;
+  if(!bench::recordedFrames(frames))
+  {
+    state.SkipWithError("BBS_BENCH_FRAMES is not a directory of frames");
+    return ;
+  }
+  // a board points to its own balls, they are never copied
+  std::vector<bbs::Board> boards(frames.size());
+  std::vector<int> found;
+  bbs::DetectBoard detector;
+  for(int i=0;i<frames.size();++i)
+  {
+    detector.reset();
+    if(detector.run(frames[i], boards[i]))
+      found.push_back(i);
+  }
+  if(found.empty())
+  {
+    state.SkipWithError("no board in the recorded frames");
+    return ;
+  }
+  bbs::Solver solver(1);
+  solver.setCacheSize(0);
+  int i = 0;
+  for(auto _ : state)
+  {
+    bbs::Solver::Solution solution = solver.run(boards[found[i]]);
+    benchmark::DoNotOptimize(solution.angle);
+    i = (i + 1) % found.size();
+  }
+  state.counters["boards"] = found.size();
+}
+BENCHMARK(BM_SolverRecorded);
+
+}
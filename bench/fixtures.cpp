@@ -0,0 +1,70 @@
+/////////////////////////////////////////////////////////////////////////
+/// BouncingBallsSolver
+/// Copyright (C) 2014 Jérôme Béchu
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////
+
+#include <cstdlib>
+
+#include "board_generator.h"
+#include "fixtures.h"
+#include "replay.h"
+
+namespace bench
+{
+
+namespace
+{
+
+bbs::BoardGenerator generator(int rows, unsigned seed)
+{
+  bbs::BoardGenerator::Settings settings;
+  settings.rows = rows;
+  settings.seed = seed;
+  return bbs::BoardGenerator(settings);
+}
+
+}
+
+void fillBoard(bbs::Board & board, int rows, unsigned seed)
+{
+  generator(rows, seed).generate(board);
+}
+
+cv::Mat renderBoard(int rows, unsigned seed)
+{
+  cv::Mat frame;
+  bbs::Board board;
+  generator(rows, seed).run(frame, board);
+  return frame;
+}
+
+bool recordedFrames(std::vector<cv::Mat> & frames)
+{
+  frames.clear();
+  char const* directory = std::getenv("BBS_BENCH_FRAMES");
+  if(!directory)
+    return false;
+  bbs::Replay replay(directory);
+  for(auto const& name : replay.frames())
+  {
+    cv::Mat frame = cv::imread(std::string(directory) + "/" + name);
+    if(frame.data)
+      frames.push_back(frame);
+  }
+  return !frames.empty();
+}
+
+}
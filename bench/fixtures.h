@@ -0,0 +1,51 @@
+/////////////////////////////////////////////////////////////////////////
+/// BouncingBallsSolver
+/// Copyright (C) 2014 Jérôme Béchu
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////
+
+#ifndef BBS_BENCH_FIXTURES_H
+#define BBS_BENCH_FIXTURES_H
+
+#include <string>
+#include <vector>
+
+#include "board.h"
+
+namespace bench
+{
+
+////////////////////////////////////////////////////////////
+/// @brief a game like board : hex packed rows of random balls
+///        (BoardGenerator, the frame grows with the rows)
+////////////////////////////////////////////////////////////
+void fillBoard(bbs::Board & board, int rows, unsigned seed);
+
+////////////////////////////////////////////////////////////
+/// @brief the game frame (BGR) of the same board as fillBoard
+///        (rows, seed)
+////////////////////////////////////////////////////////////
+cv::Mat renderBoard(int rows, unsigned seed);
+
+////////////////////////////////////////////////////////////
+/// @brief the recorded frames of the directory named by the
+///        BBS_BENCH_FRAMES environment variable (N.png)
+/// @return false if it is not set or holds no frame
+////////////////////////////////////////////////////////////
+bool recordedFrames(std::vector<cv::Mat> & frames);
+
+}
+
+#endif // BBS_BENCH_FIXTURES_H
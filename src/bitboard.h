@@ -0,0 +1,248 @@
+/////////////////////////////////////////////////////////////////////////
+/// BouncingBallsSolver
+/// Copyright (C) 2014 Jérôme Béchu
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////
+
+#ifndef BBS_BITBOARD_H
+#define BBS_BITBOARD_H
+
+#include <cstdint>
+
+namespace bbs
+{
+
+////////////////////////////////////////////////////////////
+/// @brief hex grid as one bit mask per row
+///        columns are in half ball steps : the neighbors of
+///        (r, c) are (r, c-2), (r, c+2), (r-1, c-1), (r-1, c+1),
+///        (r+1, c-1) and (r+1, c+1), a shift of the rows by 2
+///        or 1 gives all of them at once
+///        a row is a Row64 (up to 64 columns) or a Row128
+////////////////////////////////////////////////////////////
+namespace bitboard
+{
+
+typedef uint64_t Row64;
+
+///! two words, bit c is in lo for c < 64, else in hi
+struct Row128
+{
+  uint64_t lo;
+  uint64_t hi;
+};
+
+inline Row128 operator|(Row128 a, Row128 b)
+{
+  Row128 r = {a.lo | b.lo, a.hi | b.hi};
+  return r;
+}
+
+inline Row128 operator&(Row128 a, Row128 b)
+{
+  Row128 r = {a.lo & b.lo, a.hi & b.hi};
+  return r;
+}
+
+inline Row128 operator~(Row128 a)
+{
+  Row128 r = {~a.lo, ~a.hi};
+  return r;
+}
+
+///! 0 < n < 64
+inline Row128 operator<<(Row128 a, int n)
+{
+  Row128 r = {a.lo << n, (a.hi << n) | (a.lo >> (64 - n))};
+  return r;
+}
+
+///! 0 < n < 64
+inline Row128 operator>>(Row128 a, int n)
+{
+  Row128 r = {(a.lo >> n) | (a.hi << (64 - n)), a.hi >> n};
+  return r;
+}
+
+inline bool operator==(Row128 a, Row128 b)
+{
+  return a.lo == b.lo && a.hi == b.hi;
+}
+
+inline bool operator!=(Row128 a, Row128 b)
+{
+  return !(a == b);
+}
+
+inline bool any(Row64 m)
+{
+  return m != 0;
+}
+
+inline bool any(Row128 m)
+{
+  return (m.lo | m.hi) != 0;
+}
+
+inline int popcount(Row64 m)
+{
+  return __builtin_popcountll(m);
+}
+
+inline int popcount(Row128 m)
+{
+  return __builtin_popcountll(m.lo) + __builtin_popcountll(m.hi);
+}
+
+///! index of the lowest bit set (any(m) must be true)
+inline int lowest(Row64 m)
+{
+  return __builtin_ctzll(m);
+}
+
+inline int lowest(Row128 m)
+{
+  return m.lo ? __builtin_ctzll(m.lo) : 64 + __builtin_ctzll(m.hi);
+}
+
+///! clear the lowest bit set
+inline void pop(Row64 & m)
+{
+  m &= m - 1;
+}
+
+inline void pop(Row128 & m)
+{
+  if(m.lo)
+    m.lo &= m.lo - 1;
+  else
+    m.hi &= m.hi - 1;
+}
+
+inline void set(Row64 & m, int col)
+{
+  m |= Row64(1) << col;
+}
+
+inline void set(Row128 & m, int col)
+{
+  if(col < 64)
+    m.lo |= uint64_t(1) << col;
+  else
+    m.hi |= uint64_t(1) << (col - 64);
+}
+
+inline bool test(Row64 m, int col)
+{
+  return (m >> col) & 1;
+}
+
+inline bool test(Row128 m, int col)
+{
+  return col < 64 ? (m.lo >> col) & 1 : (m.hi >> (col - 64)) & 1;
+}
+
+////////////////////////////////////////////////////////////
+/// @brief neighbors in the rows above and below of a row
+////////////////////////////////////////////////////////////
+template<typename Mask>
+inline Mask diagonal(Mask m)
+{
+  return (m << 1) | (m >> 1);
+}
+
+////////////////////////////////////////////////////////////
+/// @brief neighbors in the same row
+////////////////////////////////////////////////////////////
+template<typename Mask>
+inline Mask beside(Mask m)
+{
+  return (m << 2) | (m >> 2);
+}
+
+////////////////////////////////////////////////////////////
+/// @brief grow mask inside allowed until it is stable
+///        (sweeps down and up over the rows reached so far,
+///        each row grown along itself)
+/// @param mask rows masks, the seeds (inside allowed)
+/// @param first, last rows holding the seeds, then the result
+////////////////////////////////////////////////////////////
+template<typename Mask>
+void flood(Mask *mask, Mask const* allowed, int rows, int & first, int & last)
+{
+  bool changed = true;
+  while(changed)
+  {
+    changed = false;
+    int top = first > 0 ? first - 1 : 0;
+    int bottom = last + 1 < rows ? last + 1 : last;
+    for(int i=0;i<2*(bottom-top+1);++i)
+    {
+      int r = i <= bottom - top ? top + i : 2 * bottom - top + 1 - i;
+      Mask m = mask[r];
+      if(r > 0)
+        m = m | (diagonal(mask[r-1]) & allowed[r]);
+      if(r + 1 < rows)
+        m = m | (diagonal(mask[r+1]) & allowed[r]);
+      // along the row
+      for(;;)
+      {
+        Mask next = m | (beside(m) & allowed[r]);
+        if(next == m)
+          break ;
+        m = next;
+      }
+      if(m != mask[r])
+      {
+        mask[r] = m;
+        changed = true;
+        if(r < first) first = r;
+        if(r > last) last = r;
+      }
+    }
+  }
+}
+
+template<typename Mask>
+void flood(Mask *mask, Mask const* allowed, int rows)
+{
+  int first = 0;
+  while(first < rows && !any(mask[first]))
+    ++first;
+  if(first == rows)
+    return ;
+  int last = rows - 1;
+  while(!any(mask[last]))
+    --last;
+  flood(mask, allowed, rows, first, last);
+}
+
+////////////////////////////////////////////////////////////
+/// @brief number of bits set in rows masks
+////////////////////////////////////////////////////////////
+template<typename Mask>
+int count(Mask const* mask, int rows)
+{
+  int n = 0;
+  for(int r=0;r<rows;++r)
+    n += popcount(mask[r]);
+  return n;
+}
+
+}
+
+}
+
+#endif // BBS_BITBOARD_H
@@ -18,6 +18,7 @@
 
 #include "board.h"
 #include "util.h"
+#include "zobrist.h"
 
 namespace bbs
 {
@@ -28,6 +29,13 @@ Board::Board()
   , height(0)
   , endGame(false)
   , ratio(0)
+  , grid_cols(0)
+  , grid_half(1)
+  , pitch(1)
+  , regular(false)
+  , bucket_size(1)
+  , bucket_cols(0)
+  , bucket_rows(0)
 {
   clear();
 }
@@ -42,6 +50,9 @@ Board::Ball::Ball(cv::Point const& point, unsigned char type)
   , disable(false)
   , count(0)
   , score(0)
+  , row(0)
+  , col(0)
+  , group(-1)
   , up_left(0)
   , up_right(0)
   , right(0)
@@ -56,7 +67,9 @@ void Board::clear()
 {
   all.clear();
   balls.clear();
-  all_indices.clear();
+  groups.clear();
+  y_min = std::numeric_limits<int>::max();
+  y_max = std::numeric_limits<int>::min();
   endGame = false;
   ratio = 0;
 }
@@ -65,170 +78,448 @@ void Board::add(cv::Point const& point, unsigned char type)
 {
   // naive approach, stack all balls for the future treatment
   all.push_back(Ball(point, type));
-  all_indices.insert(point.y);
+  y_min = std::min(y_min, point.y);
+  y_max = std::max(y_max, point.y);
+}
+
+int Board::indexOf(cv::Point const& point) const
+{
+  for(int i=0;i<all.size();++i)
+  {
+    if(all[i].point == point)
+      return i;
+  }
+  return -1;
+}
+
+bool Board::remove(cv::Point const& point)
+{
+  int index = indexOf(point);
+  if(index < 0)
+    return false;
+  all.erase(all.begin() + index);
+  // the first row may be gone, the grid starts at y_min
+  y_min = std::numeric_limits<int>::max();
+  y_max = std::numeric_limits<int>::min();
+  for(auto & b : all)
+  {
+    y_min = std::min(y_min, b.point.y);
+    y_max = std::max(y_max, b.point.y);
+  }
+  return true;
+}
+
+bool Board::retype(cv::Point const& point, unsigned char type)
+{
+  int index = indexOf(point);
+  if(index < 0)
+    return false;
+  all[index].type = type;
+  return true;
 }
 
 void Board::rearange()
 {
-  // resize the array with the number of row
-  balls.resize(all_indices.size());
-  // for each one
-  for(auto &b : all)
+  // keep the rows and groups memory, only empty them
+  for(auto & row : balls)
+    row.clear();
+  for(auto & group : groups)
+    group.clear();
+  if(all.empty())
   {
-    // where the row location of this ball ?
-    int index = std::distance(all_indices.begin(), all_indices.find(b.point.y));
-    balls[index].push_back(&b);
+    balls.clear();
+    groups.clear();
+    bucket_balls.clear();
+    bucket_cols = bucket_rows = 0;
+    ratio = 0;
+    return ;
   }
 
-  // determine if the order of ball for each rows
-  for(auto &b : balls)
+  // rows, columns and links with neighbors (like an hexagon)
+  buildGrid();
+
+  // the ball is falling down ?
+  if(regular && grid_cols <= 64)
+    dropBits<bitboard::Row64>();
+  else if(regular && grid_cols <= 128)
+    dropBits<bitboard::Row128>();
+  else
+    findFallingBalls();
+
+  // spatial index for find/cast
+  buildBuckets();
+
+  // am i in interessant place ?
+  groupBalls();
+
+  // compute the score, the same for the whole group
+  calcScore();
+
+  int ok = 0;
+  for(auto & b : all)
   {
-    std::sort(b.begin(), b.end(),
+    if(b.count > 1)
+      ok ++;
+  }
+  ratio = double(ok) / double(all.size());
+}
+
+void Board::buildGrid()
+{
+  // the row of a ball is the rank of its y position
+  row_of_y.assign(y_max - y_min + 1, -1);
+  for(auto & b : all)
+    row_of_y[b.point.y - y_min] = 0;
+  int rows = 0;
+  for(auto & r : row_of_y)
+  {
+    if(r == 0)
+      r = rows++;
+  }
+
+  balls.resize(rows);
+  int x_min = std::numeric_limits<int>::max();
+  int x_max = std::numeric_limits<int>::min();
+  for(auto & b : all)
+  {
+    b.row = row_of_y[b.point.y - y_min];
+    balls[b.row].push_back(&b);
+    x_min = std::min(x_min, b.point.x);
+    x_max = std::max(x_max, b.point.x);
+  }
+
+  // half of the distance between two balls of the same row,
+  // it is also the offset between two rows
+  int half = std::numeric_limits<int>::max();
+  for(int r=0;r<rows;++r)
+  {
+    Ball::PtrList & row = balls[r];
+    std::sort(row.begin(), row.end(),
               [](Ball const* a, Ball const* b){return a->point.x < b->point.x;});
-    if(b.size() > 1)
+    for(int i=1;i<row.size();++i)
     {
-      for(int i=0;i<b.size()-1;++i)
+      int dx = row[i]->point.x - row[i-1]->point.x;
+      if(dx > 1)
+        half = std::min(half, dx / 2);
+    }
+    if(r == 0)
+      continue ;
+    // closest ball of the previous row (both rows are sorted)
+    Ball::PtrList const& previous = balls[r-1];
+    int j = 0;
+    for(auto b : row)
+    {
+      while(j + 1 < previous.size() && previous[j+1]->point.x <= b->point.x)
+        ++j;
+      for(int k=j;k<=j+1 && k<previous.size();++k)
       {
-        // this ball is close to the current ?
-        if(distance(b[i]->point, b[i+1]->point) <= radius*2)
-        {
-          b[i]->right = b[i+1];
-          b[i+1]->left = b[i];
-        }
+        int dx = std::abs(previous[k]->point.x - b->point.x);
+        if(dx > 0)
+          half = std::min(half, dx);
       }
     }
   }
+  if(half == std::numeric_limits<int>::max())
+    half = radius;
+
+  // smallest gap between two rows (hexagonal packing without it)
+  pitch = std::numeric_limits<float>::max();
+  for(int r=1;r<rows;++r)
+    pitch = std::min<float>(pitch, balls[r][0]->point.y - balls[r-1][0]->point.y);
+  if(rows < 2)
+    pitch = half * std::sqrt(3.f);
+  grid_origin = cv::Point(x_min, y_min);
+  grid_half = half;
 
-  // create link with up/down balls (like an hexagon)
-  for(int i=0;i<balls.size();++i)
+  grid_cols = (x_max - x_min + half / 2) / half + 1;
+  cells.assign(rows * grid_cols, -1);
+  regular = true;
+  for(int i=0;i<all.size();++i)
   {
-    Ball::PtrList *cur = &balls[i];
-    if(i < balls.size()-1)
-    {
-      Ball::PtrList *next = &balls[i+1];
-      for(auto ball : *cur)
-      {
-        for(auto ball_next : *next)
-        {
-          if(distance(ball_next->point, ball->point) <= radius*2)
-          {
-            if(ball_next->is_left_of(ball))
-            {
-              ball->down_left = ball_next;
-            }
-            else if(ball_next->is_right_of(ball))
-            {
-              ball->down_right = ball_next;
-            }
-          }
-        }
-      }
-    }
-    if(i > 0)
+    Ball & b = all[i];
+    b.col = (b.point.x - x_min + half / 2) / half;
+    int & c = cells[b.row * grid_cols + b.col];
+    // two balls on the same cell : keep the first one
+    if(c < 0)
+      c = i;
+    else
+      regular = false;
+  }
+
+  // only link balls that touch each other
+  for(auto & b : all)
+  {
+    Ball *n[6] = {
+      cell(b.row, b.col - 2), cell(b.row, b.col + 2),
+      cell(b.row - 1, b.col - 1), cell(b.row - 1, b.col + 1),
+      cell(b.row + 1, b.col - 1), cell(b.row + 1, b.col + 1)
+    };
+    for(auto & p : n)
     {
-      Ball::PtrList *previous = &balls[i-1];
-      for(auto ball : *cur)
+      if(p && (p == &b || distance(p->point, b.point) > radius*2))
       {
-        for(auto ball_next : *previous)
-        {
-          if(distance(ball_next->point, ball->point) <= radius*2)
-          {
-            if(ball_next->is_left_of(ball))
-            {
-              ball->up_left = ball_next;
-            }
-            else if(ball_next->is_right_of(ball))
-            {
-              ball->up_right = ball_next;
-            }
-          }
-        }
+        p = 0;
+        regular = false;
       }
     }
+    b.left = n[0];
+    b.right = n[1];
+    b.up_left = n[2];
+    b.up_right = n[3];
+    b.down_left = n[4];
+    b.down_right = n[5];
   }
+}
 
-  for(auto & row : balls)
+Board::Ball *Board::cell(int row, int col) const
+{
+  if(row < 0 || col < 0 || row >= balls.size() || col >= grid_cols)
+    return 0;
+  int index = cells[row * grid_cols + col];
+  return index < 0 ? 0 : const_cast<Ball*>(&all[index]);
+}
+
+cv::Point2f Board::center(int row, int col) const
+{
+  return cv::Point2f(grid_origin.x + col * grid_half, grid_origin.y + row * pitch);
+}
+
+void Board::locate(cv::Point2f const& point, int & row, int & col) const
+{
+  row = std::floor((point.y - grid_origin.y) / pitch + 0.5f);
+  col = std::floor((point.x - grid_origin.x) / grid_half + 0.5f);
+}
+
+uint64_t Board::hash() const
+{
+  uint64_t h = zobrist::tagged(zobrist::kPlayer, player.type)
+             ^ zobrist::tagged(zobrist::kGeometry, (uint64_t(width) << 32) | (uint64_t(uint16_t(radius)) << 16) | uint16_t(height))
+             ^ zobrist::tagged(zobrist::kGeometry, (uint64_t(player.point.x) << 32) | player.point.y | (1ull << 31));
+  if(endGame)
+    h ^= zobrist::tagged(zobrist::kEndGame, 1);
+  for(auto & b : all)
   {
-    for(auto b : row)
+    // the solver works on pixels : the cell is the position
+    uint64_t cell = (uint64_t(uint16_t(b.point.y)) << 17) | (uint64_t(uint16_t(b.point.x)) << 1) | b.disable;
+    h ^= zobrist::key(cell, b.type);
+  }
+  return h;
+}
+
+bool Board::exportState(BoardState & state) const
+{
+  // every ball of the grid has the same (row + col) parity
+  int r, c;
+  int parity = 0;
+  if(!all.empty())
+  {
+    locate(all[0].point, r, c);
+    parity = (r + c) & 1;
+  }
+  locate(cv::Point2f(0, height), r, c);
+  if(!state.reset(std::max(1, r + 1), std::max(1, grid_cols), parity))
+    return false;
+  for(auto & b : all)
+  {
+    if(b.disable)
+      continue ;
+    locate(b.point, r, c);
+    if(state.valid(r, c))
+      state.set(r, c, b.type);
+  }
+  return true;
+}
+
+int Board::root(int index)
+{
+  while(parent[index] != index)
+  {
+    // path halving
+    parent[index] = parent[parent[index]];
+    index = parent[index];
+  }
+  return index;
+}
+
+void Board::groupBalls()
+{
+  parent.resize(all.size());
+  for(int i=0;i<all.size();++i)
+  {
+    parent[i] = i;
+    all[i].group = -1;
+  }
+
+  // each link is seen once : right, down left and down right
+  for(int i=0;i<all.size();++i)
+  {
+    Ball & b = all[i];
+    if(b.disable)
+      continue ;
+    Ball *n[3] = {b.right, b.down_left, b.down_right};
+    for(auto p : n)
     {
-      // the ball is falling down ?
-      b->disable = !hasTopParent(b);
-      // am i in interessant place ?
-      b->count = howSameBallInGroup(b->similar, b, b->type);
+      if(!p || p->disable || p->type != b.type)
+        continue ;
+      int a = root(i);
+      int c = root(p - &all[0]);
+      if(a != c)
+        parent[std::max(a, c)] = std::min(a, c);
     }
   }
-  Ball::PtrList done;
+
+  // one group per root, in the board order
+  int count = 0;
   for(auto & row : balls)
   {
     for(auto b : row)
     {
-      if(std::find(done.begin(), done.end(), b) != done.end())
+      if(b->disable)
+      {
+        b->group = -1;
+        b->count = 0;
+        // may be a ball of the last rearange
+        b->score = 0;
         continue ;
-      if(b->disable) continue ;
-      // compute the score
-      b->score = calcScore(b->similar, b);
-      for(auto p : b->similar)
+      }
+      Ball & r = all[root(b - &all[0])];
+      if(r.group < 0)
       {
-        p->score = b->score;
-        done.push_back(p);
+        r.group = count++;
+        if(groups.size() < count)
+          groups.push_back(Ball::PtrList());
       }
+      b->group = r.group;
+      groups[b->group].push_back(b);
     }
   }
-
-
-  int ok = 0;
-  for(auto & row : balls)
+  groups.resize(count);
+  for(auto & group : groups)
   {
-    for(auto b : row)
-    {
-        if(b->count > 1)
-            ok ++;
-    }
+    for(auto p : group)
+      p->count = group.size();
   }
-  ratio = double(ok) / double(all.size());
 }
 
-bool Board::allParent(Ball::PtrList const& sameballs, Ball::PtrList &done, Ball *ball)
+std::vector<bitboard::Row64> & Board::bits(bitboard::Row64)
 {
-  if(!ball) return true;
-  if(ball->disable == true) return false;
-
-  if(std::find(sameballs.begin(), sameballs.end(), ball) != sameballs.end())
-    return true;
-  if(std::find(done.begin(), done.end(), ball) != done.end())
-    return true;
+  return bits64;
+}
 
-  done.push_back(ball);
+std::vector<bitboard::Row128> & Board::bits(bitboard::Row128)
+{
+  return bits128;
+}
 
-  if(ball->point.y == *all_indices.begin())
-    return false;
+template<typename Mask>
+void Board::dropBits()
+{
+  int rows = balls.size();
+  std::vector<Mask> & masks = bits(Mask());
+  masks.assign(2 * rows, Mask());
+  Mask *occupied = &masks[0];
+  Mask *anchored = &masks[rows];
+  for(auto & b : all)
+    bitboard::set(occupied[b.row], b.col);
 
-  return allParent(sameballs, done, ball->up_left)
-      && allParent(sameballs, done, ball->up_right)
-      && allParent(sameballs, done, ball->left)
-      && allParent(sameballs, done, ball->right)
-      && allParent(sameballs, done, ball->down_left)
-      && allParent(sameballs, done, ball->down_right);
+  // the top row, and everything linked to it
+  anchored[0] = occupied[0];
+  bitboard::flood(anchored, occupied, rows);
+  for(auto & b : all)
+    b.disable = !bitboard::test(anchored[b.row], b.col);
 }
 
-int Board::calcScore(const Ball::PtrList &sameballs, Ball *ball)
+void Board::calcScore()
 {
-  if(!ball) return 0;
-  if(ball->disable == true) return 0;
+  int n = groups.size();
+  // the last node is the ceiling
+  int top = n;
 
-  int cpt = 0;
-  for(auto & bb : balls)
+  // links between groups, each one is seen from both sides
+  links_begin.assign(n + 2, 0);
+  for(auto & b : all)
   {
-    for(auto b : bb)
+    if(b.disable)
+      continue ;
+    Ball *neighbors[6] = {b.up_left, b.up_right, b.right, b.down_right, b.down_left, b.left};
+    for(auto p : neighbors)
+    {
+      if(p && !p->disable && p->group != b.group)
+        links_begin[b.group + 1]++;
+    }
+    if(b.point.y == y_first_row())
     {
-      Ball::PtrList done;
-      if(allParent(sameballs, done, b))
+      links_begin[b.group + 1]++;
+      links_begin[top + 1]++;
+    }
+  }
+  for(int i=0;i<=n;++i)
+    links_begin[i+1] += links_begin[i];
+  links.resize(links_begin[n+1]);
+  // use discovery as a write cursor
+  discovery.assign(links_begin.begin(), links_begin.end() - 1);
+  for(auto & b : all)
+  {
+    if(b.disable)
+      continue ;
+    Ball *neighbors[6] = {b.up_left, b.up_right, b.right, b.down_right, b.down_left, b.left};
+    for(auto p : neighbors)
+    {
+      if(p && !p->disable && p->group != b.group)
+        links[discovery[b.group]++] = p->group;
+    }
+    if(b.point.y == y_first_row())
+    {
+      links[discovery[b.group]++] = top;
+      links[discovery[top]++] = b.group;
+    }
+  }
+
+  // depth first search from the ceiling : a child whose subtree has
+  // no link above its parent falls with the parent
+  discovery.assign(n + 1, -1);
+  low.assign(n + 1, 0);
+  subtree.assign(n + 1, 0);
+  scores.assign(n + 1, 0);
+  stack.clear();
+
+  int time = 0;
+  discovery[top] = low[top] = time++;
+  stack.push_back(std::make_pair(top, links_begin[top]));
+  while(!stack.empty())
+  {
+    int node = stack.back().first;
+    int & next = stack.back().second;
+    if(next < links_begin[node+1])
+    {
+      int child = links[next++];
+      if(discovery[child] < 0)
+      {
+        discovery[child] = low[child] = time++;
+        subtree[child] = scores[child] = groups[child].size();
+        stack.push_back(std::make_pair(child, links_begin[child]));
+      }
+      else
       {
-        cpt++;
+        low[node] = std::min(low[node], discovery[child]);
       }
+      continue ;
     }
+    stack.pop_back();
+    if(stack.empty())
+      break ;
+    int up = stack.back().first;
+    low[up] = std::min(low[up], low[node]);
+    subtree[up] += subtree[node];
+    if(low[node] >= discovery[up])
+      scores[up] += subtree[node];
+  }
+
+  for(int g=0;g<n;++g)
+  {
+    for(auto p : groups[g])
+      p->score = scores[g];
   }
-  return cpt;
 }
 
 void Board::drawBall(cv::Mat & game) const
@@ -248,55 +539,202 @@ void Board::drawBall(cv::Mat & game) const
   }
 }
 
-int Board::howSameBallInGroup(Ball::PtrList &sameballs, Ball *ball, unsigned char type)
+void Board::buildBuckets()
 {
-  if(!ball) return 0;
-  if(ball->disable == true) return 0;
-  if(std::find(sameballs.begin(), sameballs.end(), ball) != sameballs.end()) return 0;
-  if(type != ball->type) return 0;
-
-  sameballs.push_back(ball);
-
-  return 1 + howSameBallInGroup(sameballs, ball->right, type)
-      + howSameBallInGroup(sameballs, ball->left, type)
-      + howSameBallInGroup(sameballs, ball->down_right, type)
-      + howSameBallInGroup(sameballs, ball->down_left, type)
-      + howSameBallInGroup(sameballs, ball->up_right, type)
-      + howSameBallInGroup(sameballs, ball->up_left, type);
+  bucket_size = std::max(1, radius * 2);
+  bucket_origin = cv::Point(std::numeric_limits<int>::max(), y_min);
+  int x_max = std::numeric_limits<int>::min();
+  for(auto & b : all)
+  {
+    bucket_origin.x = std::min(bucket_origin.x, b.point.x);
+    x_max = std::max(x_max, b.point.x);
+  }
+  bucket_cols = (x_max - bucket_origin.x) / bucket_size + 1;
+  bucket_rows = (y_max - bucket_origin.y) / bucket_size + 1;
+
+  // counting sort of the enabled balls
+  bucket_begin.assign(bucket_cols * bucket_rows + 1, 0);
+  for(auto & b : all)
+  {
+    if(b.disable) continue ;
+    bucket_begin[bucketY(b.point.y) * bucket_cols + bucketX(b.point.x) + 1]++;
+  }
+  for(int i=1;i<bucket_begin.size();++i)
+    bucket_begin[i] += bucket_begin[i-1];
+  bucket_balls.resize(bucket_begin.back());
+  // bottom rows first, like the old linear scan
+  for(auto row = balls.rbegin(); row != balls.rend(); ++row)
+  {
+    for(auto b : *row)
+    {
+      if(b->disable) continue ;
+      int i = bucketY(b->point.y) * bucket_cols + bucketX(b->point.x);
+      bucket_balls[bucket_begin[i]++] = b;
+    }
+  }
+  // the cursors are now at the start of the next bucket
+  for(int i=bucket_begin.size()-1;i>0;--i)
+    bucket_begin[i] = bucket_begin[i-1];
+  bucket_begin[0] = 0;
+}
+
+int Board::bucketX(float x) const
+{
+  return std::floor((x - bucket_origin.x) / bucket_size);
+}
+
+int Board::bucketY(float y) const
+{
+  return std::floor((y - bucket_origin.y) / bucket_size);
+}
+
+float Board::contact() const
+{
+  return int(radius*0.7) + int(radius*0.8);
+}
+
+bool Board::query(cv::Rect const& area, Ball::PtrList & myballs) const
+{
+  int c0 = std::max(0, bucketX(area.x));
+  int c1 = std::min(bucket_cols - 1, bucketX(area.x + area.width));
+  int r0 = std::max(0, bucketY(area.y));
+  int r1 = std::min(bucket_rows - 1, bucketY(area.y + area.height));
+  size_t before = myballs.size();
+  for(int r=r0;r<=r1;++r)
+  {
+    for(int c=c0;c<=c1;++c)
+    {
+      int i = r * bucket_cols + c;
+      myballs.insert(myballs.end(), bucket_balls.begin() + bucket_begin[i],
+                     bucket_balls.begin() + bucket_begin[i+1]);
+    }
+  }
+  return myballs.size() > before;
 }
 
 bool Board::find(cv::Point const& target, Ball::PtrList & myballs) const
 {
-  for(auto bb = balls.rbegin(); bb!=balls.rend();++bb)
+  // the contact distance is smaller than a bucket
+  int c = bucketX(target.x);
+  int r = bucketY(target.y);
+  size_t before = myballs.size();
+  for(int y=std::max(0, r-1);y<=std::min(bucket_rows-1, r+1);++y)
   {
-    for(auto b : *bb)
+    for(int x=std::max(0, c-1);x<=std::min(bucket_cols-1, c+1);++x)
     {
-      if(b->disable == true) continue ;
-      if(circlesColliding(b->point.x, b->point.y, radius*0.7, target.x, target.y, radius*0.8))
+      int i = y * bucket_cols + x;
+      for(int k=bucket_begin[i];k<bucket_begin[i+1];++k)
       {
-        myballs.push_back(b);
+        Ball *b = bucket_balls[k];
+        if(circlesColliding(b->point.x, b->point.y, radius*0.7, target.x, target.y, radius*0.8))
+        {
+          myballs.push_back(b);
+        }
       }
     }
   }
-  return myballs.size() > 0;
+  return myballs.size() > before;
 }
 
-bool Board::hasTopParent(Board::Ball *ball, Board::Ball::PtrList previous)
+Board::Ball *Board::cast(cv::Point2f const& origin, cv::Point2f const& direction, float length, float & t) const
 {
-  if(!ball) return false;
-  // this ball is a top ball ;)
-  if(ball->point.y == y_first_row())
-    return true;
-  // seen
-  if(std::find(previous.begin(), previous.end(), ball) != previous.end())
-    return false;
-  previous.push_back(ball);
-  return    hasTopParent(ball->up_left, previous)
-      || hasTopParent(ball->up_right, previous)
-      || hasTopParent(ball->left, previous)
-      || hasTopParent(ball->right, previous)
-      || hasTopParent(ball->down_left, previous)
-          || hasTopParent(ball->down_right, previous);
+  float reach = contact();
+  Ball *first = 0;
+  t = length;
+  if(bucket_balls.empty())
+    return 0;
+
+  // visit the rows of buckets in the direction of the shot,
+  // only the buckets close to the segment
+  int r0 = std::max(0, bucketY(std::min(origin.y, origin.y + direction.y * length) - reach));
+  int r1 = std::min(bucket_rows - 1, bucketY(std::max(origin.y, origin.y + direction.y * length) + reach));
+  // the segment is above or below all the balls
+  if(r0 > r1)
+    return 0;
+  int step = direction.y < 0 ? -1 : 1;
+  if(step < 0)
+    std::swap(r0, r1);
+  for(int r=r0;r!=r1+step;r+=step)
+  {
+    // part of the segment close enough to this row
+    float top = bucket_origin.y + r * bucket_size - reach;
+    float bottom = top + bucket_size + 2 * reach;
+    float s0 = 0;
+    float s1 = length;
+    if(std::fabs(direction.y) > 1e-6)
+    {
+      float ta = (top - origin.y) / direction.y;
+      float tb = (bottom - origin.y) / direction.y;
+      s0 = std::max(s0, std::min(ta, tb));
+      s1 = std::min(s1, std::max(ta, tb));
+    }
+    else if(origin.y < top || origin.y > bottom)
+    {
+      continue ;
+    }
+    // the next rows are even further
+    if(s0 > t)
+      break ;
+    if(s0 > s1)
+      continue ;
+
+    float xa = origin.x + direction.x * s0;
+    float xb = origin.x + direction.x * s1;
+    int c0 = std::max(0, bucketX(std::min(xa, xb) - reach));
+    int c1 = std::min(bucket_cols - 1, bucketX(std::max(xa, xb) + reach));
+    if(c0 > c1)
+      continue ;
+    for(int k=bucket_begin[r * bucket_cols + c0];k<bucket_begin[r * bucket_cols + c1 + 1];++k)
+    {
+      Ball *b = bucket_balls[k];
+      // solve |origin + hit * direction - center| = contact
+      float fx = origin.x - b->point.x;
+      float fy = origin.y - b->point.y;
+      float c = fx * fx + fy * fy - reach * reach;
+      float h = fx * direction.x + fy * direction.y;
+      float hit = 0;
+      if(c >= 0)
+      {
+        // moving away or missing the ball
+        float delta = h * h - c;
+        if(h >= 0 || delta <= 0) continue ;
+        hit = -h - std::sqrt(delta);
+      }
+      if(hit < t)
+      {
+        t = hit;
+        first = b;
+      }
+    }
+  }
+  return first;
+}
+
+void Board::findFallingBalls()
+{
+  queue.clear();
+  for(auto & b : all)
+  {
+    // this ball is a top ball ;)
+    b.disable = b.point.y != y_first_row();
+    if(!b.disable)
+      queue.push_back(&b);
+  }
+  // the queue never holds a ball twice, no need to pop
+  for(int i=0;i<queue.size();++i)
+  {
+    Ball *ball = queue[i];
+    Ball *neighbors[6] = {ball->up_left, ball->up_right, ball->left,
+                          ball->right, ball->down_left, ball->down_right};
+    for(auto p : neighbors)
+    {
+      if(p && p->disable)
+      {
+        p->disable = false;
+        queue.push_back(p);
+      }
+    }
+  }
 }
 
 }
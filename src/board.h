@@ -21,7 +21,9 @@
 
 #include <opencv2/opencv.hpp>
 #include <iomanip>
-#include <set>
+
+#include "bitboard.h"
+#include "board_state.h"
 
 namespace bbs
 {
@@ -59,6 +61,12 @@ public:
     int count;
     ///! what's the score ?
     int score;
+    ///! row index (0 is the top row)
+    int row;
+    ///! hex grid column, in half ball steps
+    int col;
+    ///! index of my group of same balls (-1 if disabled)
+    int group;
     ///! pointer to my neighbors
     Ball *up_left;
     Ball *up_right;
@@ -66,8 +74,6 @@ public:
     Ball *down_right;
     Ball *down_left;
     Ball *left;
-    ///! list of same ball in my group
-    PtrList similar;
   };
 
   Board();
@@ -83,6 +89,19 @@ public:
   ////////////////////////////////////////////////////////////
   void add(cv::Point const& point, unsigned char type);
 
+  ////////////////////////////////////////////////////////////
+  /// @brief remove the ball at a position (rearange after)
+  /// @return false if there is no ball there
+  ////////////////////////////////////////////////////////////
+  bool remove(cv::Point const& point);
+
+  ////////////////////////////////////////////////////////////
+  /// @brief change the type of the ball at a position
+  ///        (rearange after)
+  /// @return false if there is no ball there
+  ////////////////////////////////////////////////////////////
+  bool retype(cv::Point const& point, unsigned char type);
+
   ////////////////////////////////////////////////////////////
   /// @brief sort & evaluate
   ////////////////////////////////////////////////////////////
@@ -103,11 +122,59 @@ public:
   ////////////////////////////////////////////////////////////
   bool find(cv::Point const& target, std::vector<Ball *> &balls) const;
 
+  ////////////////////////////////////////////////////////////
+  /// @brief enabled balls whose bucket intersect an area
+  ///        (candidates, the caller does the exact test)
+  ////////////////////////////////////////////////////////////
+  bool query(cv::Rect const& area, std::vector<Ball *> &balls) const;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief first enabled ball hit by a ball moving on a segment
+  /// @param direction unit vector
+  /// @param length of the segment
+  /// @param t distance travelled until the hit
+  ////////////////////////////////////////////////////////////
+  Ball *cast(cv::Point2f const& origin, cv::Point2f const& direction, float length, float & t) const;
+
   ////////////////////////////////////////////////////////////
   /// @brief return the number of ball
   ////////////////////////////////////////////////////////////
   int count_ball() const;
 
+  ////////////////////////////////////////////////////////////
+  /// @brief every ball, the falling ones included
+  ////////////////////////////////////////////////////////////
+  Ball::List const& all_balls() const;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief Zobrist hash of the balls (pixel position, type,
+  ///        falling or not), the player, the board size and radius
+  ///        two frames with the same hash get the same solution
+  ////////////////////////////////////////////////////////////
+  uint64_t hash() const;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief hex grid geometry (valid after rearange)
+  ///        row r is at y_first_row() + r * pitch, columns are
+  ///        in half ball steps, (row + col) keeps the same parity
+  ////////////////////////////////////////////////////////////
+  int grid_columns() const;
+  float grid_pitch() const;
+  cv::Point2f center(int row, int col) const;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief nearest grid position of a pixel (may be outside
+  ///        the grid, the parity is not checked)
+  ////////////////////////////////////////////////////////////
+  void locate(cv::Point2f const& point, int & row, int & col) const;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief the enabled balls on a grid down to the bottom of
+  ///        the board (valid after rearange)
+  /// @return false if the grid is too big for a BoardState
+  ////////////////////////////////////////////////////////////
+  bool exportState(BoardState & state) const;
+
   ///! contains useful information about the player
   Ball player;
 
@@ -124,25 +191,72 @@ public:
 
 private:
   ////////////////////////////////////////////////////////////
-  /// @brief test if a ball is link to the board
+  /// @brief disable balls not linked to the top row
+  ///        (one flood fill from the top row)
+  ////////////////////////////////////////////////////////////
+  void findFallingBalls();
+
+  ////////////////////////////////////////////////////////////
+  /// @brief place balls on the hex grid and link neighbors
   ////////////////////////////////////////////////////////////
-  bool hasTopParent(Ball *ball, Ball::PtrList previous=Ball::PtrList());
+  void buildGrid();
 
   ////////////////////////////////////////////////////////////
-  /// @brief return the number of identic ball found in the current group
+  /// @brief sort enabled balls in square buckets (spatial index)
   ////////////////////////////////////////////////////////////
-  int howSameBallInGroup(Ball::PtrList &sameballs, Ball *ball, unsigned char type);
+  void buildBuckets();
 
   ////////////////////////////////////////////////////////////
-  /// @brief calculate the score balls
-  ///        how many balls depends on me ?
+  /// @brief bucket of a pixel coordinate (may be outside)
   ////////////////////////////////////////////////////////////
-  int calcScore(Ball::PtrList const& sameballs, Ball *ball);
+  int bucketX(float x) const;
+  int bucketY(float y) const;
 
   ////////////////////////////////////////////////////////////
-  /// @brief return true if all parents of ball is contains in sameballs vector
+  /// @brief contact distance between a shot and a ball
   ////////////////////////////////////////////////////////////
-  bool allParent(const Ball::PtrList &sameballs, Ball::PtrList &done, Ball *ball);
+  float contact() const;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief label groups of same enabled balls (union find)
+  ////////////////////////////////////////////////////////////
+  void groupBalls();
+
+  ////////////////////////////////////////////////////////////
+  /// @brief findFallingBalls as one bitboard flood
+  ///        (regular grid, at most one Mask of columns)
+  ////////////////////////////////////////////////////////////
+  template<typename Mask> void dropBits();
+
+  ////////////////////////////////////////////////////////////
+  /// @brief scratch rows of a mask type
+  ////////////////////////////////////////////////////////////
+  std::vector<bitboard::Row64> & bits(bitboard::Row64);
+  std::vector<bitboard::Row128> & bits(bitboard::Row128);
+
+  ////////////////////////////////////////////////////////////
+  /// @brief union find root of a ball index
+  ////////////////////////////////////////////////////////////
+  int root(int index);
+
+  ////////////////////////////////////////////////////////////
+  /// @brief index in all of the ball at a position, or -1
+  ////////////////////////////////////////////////////////////
+  int indexOf(cv::Point const& point) const;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief ball at a grid position, null outside the grid
+  ////////////////////////////////////////////////////////////
+  Ball *cell(int row, int col) const;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief calculate the score of every group
+  ///        how many balls fall if my group is popped ?
+  ///        the groups are the nodes of a graph linked to the
+  ///        top row, a group fall with the one it depends on
+  ///        (articulation points, one depth first sweep)
+  ////////////////////////////////////////////////////////////
+  void calcScore();
 
   ///! contains all detected balls
   Ball::List all;
@@ -150,13 +264,58 @@ private:
   ///! sorted array of balls
   std::vector<Ball::PtrList> balls;
 
-  ///! contains y positions of balls
-  std::set<int> all_indices;
+  ///! groups of same balls
+  std::vector<Ball::PtrList> groups;
+
+  ///! y range of the balls
+  int y_min;
+  int y_max;
+
+  ///! hex grid, index of the ball in all (or -1)
+  std::vector<int> cells;
+  ///! number of columns of the grid
+  int grid_cols;
+  ///! pixel position of the cell (0, 0)
+  cv::Point grid_origin;
+  ///! half distance between two balls of a row
+  int grid_half;
+  ///! distance between two rows
+  float pitch;
+  ///! one ball per cell, and grid neighbors always touch
+  bool regular;
+
+  ///! scratch arrays, kept to avoid allocations
+  std::vector<int> row_of_y;
+  std::vector<int> parent;
+  ///! links between groups (compressed rows)
+  std::vector<int> links_begin;
+  std::vector<int> links;
+  ///! depth first search state
+  std::vector<int> discovery;
+  std::vector<int> low;
+  std::vector<int> subtree;
+  std::vector<int> scores;
+  std::vector<std::pair<int, int> > stack;
+  std::vector<Ball*> queue;
+  ///! bitboard rows masks
+  std::vector<bitboard::Row64> bits64;
+  std::vector<bitboard::Row128> bits128;
+
+  ///! spatial index : enabled balls sorted by square buckets
+  ///! of one ball diameter, bucket (c, r) is in
+  ///! bucket_balls[bucket_begin[i]..bucket_begin[i+1]] with
+  ///! i = r * bucket_cols + c
+  cv::Point bucket_origin;
+  int bucket_size;
+  int bucket_cols;
+  int bucket_rows;
+  std::vector<int> bucket_begin;
+  std::vector<Ball*> bucket_balls;
 };
 
 inline int Board::y_first_row() const
 {
-  return *all_indices.begin();
+  return y_min;
 }
 
 inline int Board::count_ball() const
@@ -164,6 +323,21 @@ inline int Board::count_ball() const
   return all.size();
 }
 
+inline Board::Ball::List const& Board::all_balls() const
+{
+  return all;
+}
+
+inline int Board::grid_columns() const
+{
+  return grid_cols;
+}
+
+inline float Board::grid_pitch() const
+{
+  return pitch;
+}
+
 }
 
 #endif //  BB_BOARD_H
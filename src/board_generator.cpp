@@ -0,0 +1,155 @@
+/////////////////////////////////////////////////////////////////////////
+/// BouncingBallsSolver
+/// Copyright (C) 2014 Jérôme Béchu
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////
+
+#include "board_generator.h"
+#include "color_conversion.h"
+
+namespace bbs
+{
+
+BoardGenerator::BoardGenerator(Settings const& settings)
+{
+  setSettings(settings);
+}
+
+void BoardGenerator::setSettings(Settings const& settings)
+{
+  settings_ = settings;
+  if(settings_.colours < 1)
+    settings_.colours = 1;
+  if(settings_.colours > kMaxColours)
+    settings_.colours = kMaxColours;
+
+  // far from the background hues (0 and 176), the palette
+  // tells apart hues 2 * kTolerance + 1 away
+  pixels_.assign(1, cv::Scalar());
+  hues_.assign(1, 0);
+  int n = settings_.colours;
+  for(int k=0;k<n;++k)
+  {
+    cv::Scalar p = pixel(20 + 140.f * k / std::max(1, n - 1), 255);
+    cv::Mat one(1, 1, CV_8UC3, p);
+    cv::Mat hue;
+    toHue(one, hue);
+    pixels_.push_back(p);
+    hues_.push_back(hue.at<unsigned char>(0, 0));
+  }
+}
+
+cv::Size BoardGenerator::size() const
+{
+  cv::Size size = settings_.size;
+  if(size.width <= 0)
+    size.width = (settings_.cols + 1) * spacing();
+  // room below the balls for the shots, the last tenth is
+  // the player area (DetectBoard does not look for balls there)
+  if(size.height <= 0)
+  {
+    int bottom = settings_.mass + spacing() / 2 + settings_.rows * pitch();
+    size.height = std::max(size.width * 6 / 7, bottom * 10 / 9 + 2 * spacing());
+  }
+  return size;
+}
+
+cv::Point BoardGenerator::center(int row, int col) const
+{
+  return cv::Point(spacing() + col * spacing() + (row % 2) * spacing() / 2,
+                   settings_.mass + spacing() / 2 + row * pitch());
+}
+
+unsigned char BoardGenerator::hue(unsigned char colour) const
+{
+  return colour < hues_.size() ? hues_[colour] : 0;
+}
+
+cv::Scalar BoardGenerator::pixel(float hue, int value)
+{
+  // channel 0 is read as red by toHue
+  float h = std::fmod(hue, 180.f) / 30.f;
+  int i = int(h);
+  float f = h - i;
+  float q = value * (1 - f);
+  float t = value * f;
+  switch(i)
+  {
+    case 0: return cv::Scalar(value, t, 0);
+    case 1: return cv::Scalar(q, value, 0);
+    case 2: return cv::Scalar(0, value, t);
+    case 3: return cv::Scalar(0, q, value);
+    case 4: return cv::Scalar(t, 0, value);
+    default: return cv::Scalar(value, 0, q);
+  }
+}
+
+void BoardGenerator::generate(Board & board) const
+{
+  cv::RNG rng(settings_.seed);
+  cv::Size frame = size();
+
+  board.clear();
+  board.width = frame.width;
+  board.height = frame.height;
+  board.radius = spacing() / 2;
+  board.endGame = settings_.mass > 0;
+  board.player.point = settings_.player;
+  if(settings_.player.x < 0)
+    board.player.point = cv::Point(frame.width / 2, frame.height - settings_.radius);
+  board.player.type = rng.uniform(1, settings_.colours + 1);
+
+  for(int r=0;r<settings_.rows;++r)
+  {
+    // odd rows are shifted, one ball less
+    for(int c=0;c<settings_.cols-r%2;++c)
+    {
+      if(rng.uniform(0.f, 1.f) >= settings_.fill)
+        continue ;
+      board.add(center(r, c), rng.uniform(1, settings_.colours + 1));
+    }
+  }
+  board.rearange();
+}
+
+void BoardGenerator::render(Board const& board, cv::Mat & frame) const
+{
+  cv::Size s = size();
+  frame.create(s, CV_8UC3);
+
+  // stripes of two hues, a plain background would look like
+  // the mass
+  frame.setTo(pixel(0, 60));
+  for(int x=0;x<s.width;x+=4)
+    cv::rectangle(frame, cv::Rect(x, 0, 2, s.height), pixel(176, 60), -1);
+  if(settings_.mass > 0)
+    cv::rectangle(frame, cv::Rect(0, 0, s.width, settings_.mass), cv::Scalar(200, 200, 200), -1);
+
+  for(auto const& ball : board.all_balls())
+  {
+    if(ball.type < pixels_.size())
+      cv::circle(frame, ball.point, settings_.radius, pixels_[ball.type], -1);
+  }
+  if(board.player.type < pixels_.size())
+    cv::circle(frame, board.player.point, settings_.radius, pixels_[board.player.type], -1);
+}
+
+void BoardGenerator::run(cv::Mat & frame, Board & board) const
+{
+  generate(board);
+  render(board, frame);
+}
+
+}
@@ -0,0 +1,151 @@
+/////////////////////////////////////////////////////////////////////////
+/// BouncingBallsSolver
+/// Copyright (C) 2014 Jérôme Béchu
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////
+
+#ifndef BBS_BOARD_GENERATOR_H
+#define BBS_BOARD_GENERATOR_H
+
+#include <opencv2/opencv.hpp>
+
+#include "board.h"
+
+namespace bbs
+{
+
+////////////////////////////////////////////////////////////
+/// @brief synthetic games : a random board (the ground
+///        truth) and the frame showing it, for any size
+///      - hex packed rows of plain discs, one hue per colour
+///      - a striped background (no wide area of one hue)
+///      - the mass, a band of one hue above the balls
+///      the types of the board are the colours (1, 2, ...)
+///      DetectBoard looks for balls of 3 to 5 % of the frame
+///      width and for the player at (210, 346) : it reads the
+///      default frames, larger games only grow in rows
+////////////////////////////////////////////////////////////
+class BoardGenerator
+{
+public:
+  ///! maximum number of colours
+  static const int kMaxColours = 16;
+
+  ///! game settings
+  struct Settings
+  {
+    Settings()
+      : rows(9)
+      , cols(13)
+      , colours(4)
+      , radius(14)
+      , fill(0.85f)
+      , mass(0)
+      , player(-1, -1)
+      , size(0, 0)
+      , seed(0)
+    {
+    }
+
+    ///! rows of balls
+    int rows;
+    ///! balls in an even row (one less in odd rows)
+    int cols;
+    ///! number of colours (1 to kMaxColours)
+    int colours;
+    ///! radius of the discs, a ball takes 2 * (radius + 1)
+    int radius;
+    ///! probability of a ball in a cell
+    float fill;
+    ///! height of the mass (0 : none)
+    int mass;
+    ///! player ball (x < 0 : middle of the bottom)
+    cv::Point player;
+    ///! frame size (0 : just enough for the balls)
+    cv::Size size;
+    ///! the same seed gives the same game
+    unsigned seed;
+  };
+
+  explicit BoardGenerator(Settings const& settings = Settings());
+
+  void setSettings(Settings const& settings);
+  Settings const& settings() const;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief frame size, grid spacing and rows pitch
+  ////////////////////////////////////////////////////////////
+  cv::Size size() const;
+  int spacing() const;
+  int pitch() const;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief center of a cell (odd rows are shifted right by
+  ///        half a ball)
+  ////////////////////////////////////////////////////////////
+  cv::Point center(int row, int col) const;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief hue of a colour, as toHue reads it
+  ////////////////////////////////////////////////////////////
+  unsigned char hue(unsigned char colour) const;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief a random board (rearanged)
+  ////////////////////////////////////////////////////////////
+  void generate(Board & board) const;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief the frame (BGR) of a board : its balls, the
+  ///        player and the mass of the settings
+  ////////////////////////////////////////////////////////////
+  void render(Board const& board, cv::Mat & frame) const;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief a random board and its frame
+  ////////////////////////////////////////////////////////////
+  void run(cv::Mat & frame, Board & board) const;
+
+private:
+  ////////////////////////////////////////////////////////////
+  /// @brief pixel of a hue (full saturation and value)
+  ////////////////////////////////////////////////////////////
+  static cv::Scalar pixel(float hue, int value);
+
+  Settings settings_;
+  ///! pixel and hue of each colour
+  std::vector<cv::Scalar> pixels_;
+  std::vector<unsigned char> hues_;
+};
+
+inline BoardGenerator::Settings const& BoardGenerator::settings() const
+{
+  return settings_;
+}
+
+inline int BoardGenerator::spacing() const
+{
+  return 2 * (settings_.radius + 1);
+}
+
+inline int BoardGenerator::pitch() const
+{
+  // hex packed, whole pixels like the game
+  return int((settings_.radius + 1) * std::sqrt(3.f) + 0.5f);
+}
+
+}
+
+#endif // BBS_BOARD_GENERATOR_H
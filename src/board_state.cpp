@@ -0,0 +1,238 @@
+/////////////////////////////////////////////////////////////////////////
+/// BouncingBallsSolver
+/// Copyright (C) 2014 Jérôme Béchu
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include <cstring>
+
+#include "board_state.h"
+#include "zobrist.h"
+
+namespace bbs
+{
+
+using bitboard::lowest;
+using bitboard::popcount;
+
+static_assert(BoardState::kCols == 64, "a row is one 64 bits mask");
+
+bool BoardState::reset(int rows, int cols, int parity)
+{
+  std::memset(type_, 0, sizeof(type_));
+  std::memset(occupied_, 0, sizeof(occupied_));
+  hash_ = 0;
+  bool fit = rows >= 0 && cols >= 0 && rows <= kRows && cols <= kCols;
+  rows_ = fit ? rows : 0;
+  cols_ = fit ? cols : 0;
+  parity_ = parity & 1;
+  return fit;
+}
+
+BoardState::RowMask BoardState::cells(int row) const
+{
+  RowMask even = 0x5555555555555555ull;
+  RowMask mask = ((row + parity_) & 1) ? ~even : even;
+  if(cols_ < kCols)
+    mask &= (RowMask(1) << cols_) - 1;
+  return mask;
+}
+
+void BoardState::set(int row, int col, unsigned char type)
+{
+  // an empty cell has no key
+  if(type_[row][col])
+    hash_ ^= zobrist::key(row * kCols + col, type_[row][col]);
+  if(type)
+    hash_ ^= zobrist::key(row * kCols + col, type);
+  type_[row][col] = type;
+  if(type)
+    occupied_[row] |= RowMask(1) << col;
+  else
+    occupied_[row] &= ~(RowMask(1) << col);
+}
+
+BoardState::RowMask BoardState::colour(int row, unsigned char type) const
+{
+  // empty cells are 0, never a type
+  if(type == 0)
+    return 0;
+#if defined(__SSE2__)
+  // the 64 bytes of the row, 16 at a time
+  __m128i t = _mm_set1_epi8(static_cast<char>(type));
+  RowMask mask = 0;
+  for(int i=0;i<4;++i)
+  {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(type_[row] + 16 * i));
+    RowMask bits = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, t)));
+    mask |= bits << (16 * i);
+  }
+  return mask;
+#else
+  RowMask mask = 0;
+  for(RowMask m = occupied_[row]; m; m &= m - 1)
+  {
+    int c = lowest(m);
+    if(type_[row][c] == type)
+      mask |= RowMask(1) << c;
+  }
+  return mask;
+#endif
+}
+
+int BoardState::count() const
+{
+  int n = 0;
+  for(int r=0;r<rows_;++r)
+    n += popcount(occupied_[r]);
+  return n;
+}
+
+int BoardState::types(bool present[256]) const
+{
+  std::memset(present, 0, 256 * sizeof(bool));
+  int n = 0;
+  for(int r=0;r<rows_;++r)
+  {
+    for(RowMask m = occupied_[r]; m; m &= m - 1)
+    {
+      unsigned char t = type_[r][lowest(m)];
+      if(!present[t])
+      {
+        present[t] = true;
+        n++;
+      }
+    }
+  }
+  return n;
+}
+
+int BoardState::group(int row, int col, RowMask mask[kRows]) const
+{
+  RowMask allowed[kRows];
+  unsigned char type = type_[row][col];
+  for(int r=0;r<rows_;++r)
+  {
+    allowed[r] = colour(r, type);
+    mask[r] = 0;
+  }
+  mask[row] = RowMask(1) << col;
+  bitboard::flood(mask, allowed, rows_);
+  return bitboard::count(mask, rows_);
+}
+
+void BoardState::anchored(RowMask mask[kRows]) const
+{
+  for(int r=0;r<rows_;++r)
+    mask[r] = 0;
+  if(rows_ == 0)
+    return ;
+  mask[0] = occupied_[0];
+  bitboard::flood(mask, occupied_, rows_);
+}
+
+void BoardState::open(RowMask mask[kRows]) const
+{
+  for(int r=0;r<rows_;++r)
+  {
+    RowMask linked = ~RowMask(0);
+    if(r > 0)
+    {
+      linked = bitboard::beside(occupied_[r]) | bitboard::diagonal(occupied_[r-1]);
+    }
+    RowMask below = 0;
+    if(r + 1 < rows_)
+      below = bitboard::diagonal(occupied_[r+1]);
+    mask[r] = cells(r) & ~occupied_[r] & linked & ~below;
+  }
+}
+
+void BoardState::erase(RowMask const mask[kRows])
+{
+  for(int r=0;r<rows_;++r)
+  {
+    for(RowMask m = mask[r]; m; m &= m - 1)
+    {
+      int c = lowest(m);
+      hash_ ^= zobrist::key(r * kCols + c, type_[r][c]);
+      type_[r][c] = 0;
+    }
+    occupied_[r] &= ~mask[r];
+  }
+}
+
+int BoardState::place(int row, int col, unsigned char type)
+{
+  set(row, col, type);
+
+  RowMask mask[kRows];
+  int removed = group(row, col, mask);
+  if(removed < 3)
+    return 0;
+  erase(mask);
+  return removed + drop();
+}
+
+int BoardState::removed(int row, int col, unsigned char type) const
+{
+  // the group of the new ball, as if it was set
+  RowMask cell = RowMask(1) << col;
+  RowMask allowed[kRows];
+  RowMask mask[kRows];
+  for(int r=0;r<rows_;++r)
+  {
+    allowed[r] = colour(r, type);
+    mask[r] = 0;
+  }
+  allowed[row] |= cell;
+  mask[row] = cell;
+  bitboard::flood(mask, allowed, rows_);
+  int popped = bitboard::count(mask, rows_);
+  if(popped < 3)
+    return 0;
+
+  // the balls left (in mask), those no longer linked to the top
+  // (allowed is free) fall
+  for(int r=0;r<rows_;++r)
+  {
+    mask[r] = occupied_[r] & ~mask[r];
+    allowed[r] = 0;
+  }
+  allowed[0] = mask[0];
+  bitboard::flood(allowed, mask, rows_);
+  int dropped = 0;
+  for(int r=0;r<rows_;++r)
+    dropped += popcount(mask[r] & ~allowed[r]);
+  return popped + dropped;
+}
+
+int BoardState::drop()
+{
+  RowMask mask[kRows];
+  anchored(mask);
+  int removed = 0;
+  for(int r=0;r<rows_;++r)
+  {
+    mask[r] = occupied_[r] & ~mask[r];
+    removed += popcount(mask[r]);
+  }
+  erase(mask);
+  return removed;
+}
+
+}
@@ -0,0 +1,189 @@
+/////////////////////////////////////////////////////////////////////////
+/// BouncingBallsSolver
+/// Copyright (C) 2014 Jérôme Béchu
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////
+
+#ifndef BBS_BOARD_STATE_H
+#define BBS_BOARD_STATE_H
+
+#include "bitboard.h"
+
+namespace bbs
+{
+
+////////////////////////////////////////////////////////////
+/// @brief a board as plain values, cheap to copy (memcpy) :
+///      - one type byte per cell of the hex grid (0 is empty)
+///      - one occupancy mask per row, bit c is the column c
+///      columns are in half ball steps like the Board grid,
+///      groups and drops are bitboard floods
+////////////////////////////////////////////////////////////
+class BoardState
+{
+public:
+  typedef bitboard::Row64 RowMask;
+
+  ///! maximum number of rows
+  static const int kRows = 16;
+  ///! maximum number of columns (one bit each)
+  static const int kCols = 64;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief an empty grid, (row + col) % 2 == parity for the
+  ///        cells, false if the size is too big
+  ////////////////////////////////////////////////////////////
+  bool reset(int rows, int cols, int parity);
+
+  int rows() const;
+  int cols() const;
+  int parity() const;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief inside the grid and on the right parity ?
+  ////////////////////////////////////////////////////////////
+  bool valid(int row, int col) const;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief type of a cell (0 : empty), must be valid
+  ////////////////////////////////////////////////////////////
+  unsigned char at(int row, int col) const;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief change a cell (0 : empty), must be valid
+  ////////////////////////////////////////////////////////////
+  void set(int row, int col, unsigned char type);
+
+  ////////////////////////////////////////////////////////////
+  /// @brief occupied cells of a row
+  ////////////////////////////////////////////////////////////
+  RowMask occupied(int row) const;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief cells of a row holding a type
+  ////////////////////////////////////////////////////////////
+  RowMask colour(int row, unsigned char type) const;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief number of balls
+  ////////////////////////////////////////////////////////////
+  int count() const;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief Zobrist hash of the balls (kept up to date)
+  ////////////////////////////////////////////////////////////
+  uint64_t hash() const;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief the types on the board
+  /// @param present 256 flags, set for each type found
+  /// @return number of types
+  ////////////////////////////////////////////////////////////
+  int types(bool present[256]) const;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief same type balls linked to a cell (the cell included)
+  /// @param mask kRows masks, the group
+  /// @return size of the group
+  ////////////////////////////////////////////////////////////
+  int group(int row, int col, RowMask mask[kRows]) const;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief balls linked to the top row
+  ////////////////////////////////////////////////////////////
+  void anchored(RowMask mask[kRows]) const;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief empty cells where a shot may stop : linked to a
+  ///        ball (or the top row), nothing just below
+  ////////////////////////////////////////////////////////////
+  void open(RowMask mask[kRows]) const;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief put a ball on an empty cell : pop its group (3 or
+  ///        more), drop the balls no longer linked to the top
+  /// @return number of removed balls
+  ////////////////////////////////////////////////////////////
+  int place(int row, int col, unsigned char type);
+
+  ////////////////////////////////////////////////////////////
+  /// @brief same count as place, the state is not changed
+  ////////////////////////////////////////////////////////////
+  int removed(int row, int col, unsigned char type) const;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief remove the balls not linked to the top row
+  /// @return number of removed balls
+  ////////////////////////////////////////////////////////////
+  int drop();
+
+private:
+  ////////////////////////////////////////////////////////////
+  /// @brief the valid cells of a row
+  ////////////////////////////////////////////////////////////
+  RowMask cells(int row) const;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief empty the cells of the masks
+  ////////////////////////////////////////////////////////////
+  void erase(RowMask const mask[kRows]);
+
+  unsigned char type_[kRows][kCols];
+  RowMask occupied_[kRows];
+  uint64_t hash_;
+  int rows_;
+  int cols_;
+  int parity_;
+};
+
+inline int BoardState::rows() const
+{
+  return rows_;
+}
+
+inline int BoardState::cols() const
+{
+  return cols_;
+}
+
+inline int BoardState::parity() const
+{
+  return parity_;
+}
+
+inline bool BoardState::valid(int row, int col) const
+{
+  return row >= 0 && col >= 0 && row < rows_ && col < cols_
+      && ((row + col) & 1) == parity_;
+}
+
+inline unsigned char BoardState::at(int row, int col) const
+{
+  return type_[row][col];
+}
+
+inline uint64_t BoardState::hash() const
+{
+  return hash_;
+}
+
+inline BoardState::RowMask BoardState::occupied(int row) const
+{
+  return occupied_[row];
+}
+
+}
+
+#endif // BBS_BOARD_STATE_H
@@ -0,0 +1,203 @@
+/////////////////////////////////////////////////////////////////////////
+/// BouncingBallsSolver
+/// Copyright (C) 2014 Jérôme Béchu
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "color_conversion.h"
+
+namespace bbs
+{
+
+namespace
+{
+
+///! same fixed point precision as opencv
+const int kHsvShift = 12;
+const int kHsvRound = 1 << (kHsvShift - 1);
+
+////////////////////////////////////////////////////////////
+/// @brief opencv hue division table (180 degrees range)
+////////////////////////////////////////////////////////////
+struct HueTable
+{
+  HueTable()
+  {
+    div[0] = 0;
+    for(int i=1;i<256;++i)
+      div[i] = cv::saturate_cast<int>((180 << kHsvShift) / (6. * i));
+  }
+  int div[256];
+};
+
+int const* hueTable()
+{
+  static HueTable table;
+  return table.div;
+}
+
+////////////////////////////////////////////////////////////
+/// @brief hue numerator, before the division by 6 * diff
+////////////////////////////////////////////////////////////
+inline int hueNumerator(int r, int g, int b, int & diff)
+{
+  int v = std::max(std::max(r, g), b);
+  int vmin = std::min(std::min(r, g), b);
+  diff = v - vmin;
+  int vr = v == r ? -1 : 0;
+  int vg = v == g ? -1 : 0;
+  return (vr & (g - b)) + (~vr & ((vg & (b - r + 2 * diff)) + ((~vg) & (r - g + 4 * diff))));
+}
+
+inline unsigned char hueFinish(int h, int diff, int const* table)
+{
+  h = (h * table[diff] + kHsvRound) >> kHsvShift;
+  h += h < 0 ? 180 : 0;
+  return static_cast<unsigned char>(h);
+}
+
+template<int kChannels>
+void scalarRow(unsigned char const* src, unsigned char *dst, int begin, int end, int const* table)
+{
+  for(int i=begin;i<end;++i)
+  {
+    unsigned char const* p = src + i * kChannels;
+    int diff;
+    int h = hueNumerator(p[0], p[1], p[2], diff);
+    dst[i] = hueFinish(h, diff, table);
+  }
+}
+
+#if defined(__AVX2__)
+
+// 8 pixels per iteration, the table lookup is a gather
+int vectorRow(unsigned char const* src, unsigned char *dst, int width, int const* table)
+{
+  const __m256i mask = _mm256_set1_epi32(0xff);
+  const __m256i round = _mm256_set1_epi32(kHsvRound);
+  const __m256i hr = _mm256_set1_epi32(180);
+  const __m256i zero = _mm256_setzero_si256();
+  int i = 0;
+  for(;i+8<=width;i+=8)
+  {
+    __m256i px = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(src + i * 4));
+    __m256i r = _mm256_and_si256(px, mask);
+    __m256i g = _mm256_and_si256(_mm256_srli_epi32(px, 8), mask);
+    __m256i b = _mm256_and_si256(_mm256_srli_epi32(px, 16), mask);
+
+    __m256i v = _mm256_max_epi32(_mm256_max_epi32(r, g), b);
+    __m256i vmin = _mm256_min_epi32(_mm256_min_epi32(r, g), b);
+    __m256i diff = _mm256_sub_epi32(v, vmin);
+    __m256i vr = _mm256_cmpeq_epi32(v, r);
+    __m256i vg = _mm256_cmpeq_epi32(v, g);
+    __m256i diff2 = _mm256_add_epi32(diff, diff);
+    __m256i diff4 = _mm256_add_epi32(diff2, diff2);
+
+    __m256i hg = _mm256_add_epi32(_mm256_sub_epi32(b, r), diff2);
+    __m256i hb = _mm256_add_epi32(_mm256_sub_epi32(r, g), diff4);
+    __m256i h = _mm256_or_si256(_mm256_and_si256(vg, hg), _mm256_andnot_si256(vg, hb));
+    h = _mm256_or_si256(_mm256_and_si256(vr, _mm256_sub_epi32(g, b)), _mm256_andnot_si256(vr, h));
+
+    __m256i div = _mm256_i32gather_epi32(table, diff, 4);
+    h = _mm256_srai_epi32(_mm256_add_epi32(_mm256_mullo_epi32(h, div), round), kHsvShift);
+    h = _mm256_add_epi32(h, _mm256_and_si256(_mm256_cmpgt_epi32(zero, h), hr));
+
+    __m128i h16 = _mm_packs_epi32(_mm256_castsi256_si128(h), _mm256_extracti128_si256(h, 1));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(h16, h16));
+  }
+  return i;
+}
+
+#elif defined(__SSE2__)
+
+// 8 pixels per iteration in 16 bits lanes, only the division is scalar
+int vectorRow(unsigned char const* src, unsigned char *dst, int width, int const* table)
+{
+  const __m128i mask = _mm_set1_epi32(0xff);
+  short hs[8] __attribute__((aligned(16)));
+  short ds[8] __attribute__((aligned(16)));
+  int i = 0;
+  for(;i+8<=width;i+=8)
+  {
+    __m128i lo = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + i * 4));
+    __m128i hi = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + i * 4 + 16));
+    __m128i r = _mm_packs_epi32(_mm_and_si128(lo, mask), _mm_and_si128(hi, mask));
+    __m128i g = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(lo, 8), mask),
+                                _mm_and_si128(_mm_srli_epi32(hi, 8), mask));
+    __m128i b = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(lo, 16), mask),
+                                _mm_and_si128(_mm_srli_epi32(hi, 16), mask));
+
+    __m128i v = _mm_max_epi16(_mm_max_epi16(r, g), b);
+    __m128i vmin = _mm_min_epi16(_mm_min_epi16(r, g), b);
+    __m128i diff = _mm_sub_epi16(v, vmin);
+    __m128i vr = _mm_cmpeq_epi16(v, r);
+    __m128i vg = _mm_cmpeq_epi16(v, g);
+    __m128i diff2 = _mm_add_epi16(diff, diff);
+    __m128i diff4 = _mm_add_epi16(diff2, diff2);
+
+    __m128i hg = _mm_add_epi16(_mm_sub_epi16(b, r), diff2);
+    __m128i hb = _mm_add_epi16(_mm_sub_epi16(r, g), diff4);
+    __m128i h = _mm_or_si128(_mm_and_si128(vg, hg), _mm_andnot_si128(vg, hb));
+    h = _mm_or_si128(_mm_and_si128(vr, _mm_sub_epi16(g, b)), _mm_andnot_si128(vr, h));
+
+    _mm_store_si128(reinterpret_cast<__m128i*>(hs), h);
+    _mm_store_si128(reinterpret_cast<__m128i*>(ds), diff);
+    for(int k=0;k<8;++k)
+      dst[i+k] = hueFinish(hs[k], ds[k], table);
+  }
+  return i;
+}
+
+#else
+
+int vectorRow(unsigned char const*, unsigned char *, int, int const*)
+{
+  return 0;
+}
+
+#endif
+
+}
+
+void toHue(cv::Mat const& frame, cv::Mat & hue)
+{
+  CV_Assert(frame.type() == CV_8UC3 || frame.type() == CV_8UC4);
+  hue.create(frame.size(), CV_8UC1);
+  int const* table = hueTable();
+  int width = frame.size().width;
+
+  for(int y=0;y<frame.size().height;++y)
+  {
+    unsigned char const* src = frame.ptr<unsigned char>(y);
+    unsigned char *dst = hue.ptr<unsigned char>(y);
+    if(frame.type() == CV_8UC4)
+    {
+      int done = vectorRow(src, dst, width, table);
+      scalarRow<4>(src, dst, done, width, table);
+    }
+    else
+    {
+      scalarRow<3>(src, dst, 0, width, table);
+    }
+  }
+}
+
+}
@@ -0,0 +1,38 @@
+/////////////////////////////////////////////////////////////////////////
+/// BouncingBallsSolver
+/// Copyright (C) 2014 Jérôme Béchu
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////
+
+#ifndef BBS_COLOR_CONVERSION_H
+#define BBS_COLOR_CONVERSION_H
+
+#include <opencv2/opencv.hpp>
+
+namespace bbs
+{
+
+////////////////////////////////////////////////////////////
+/// @brief compute the hue plane of a captured frame
+///        accept BGR (CV_8UC3) or BGRX (CV_8UC4, raw X11 layout)
+///        the result is bit exact with the historical
+///        cvtColor(frame, CV_RGB2HSV) + split()[0]
+///        (channel 0 is read as red, like it always was)
+////////////////////////////////////////////////////////////
+void toHue(cv::Mat const& frame, cv::Mat & hue);
+
+}
+
+#endif // BBS_COLOR_CONVERSION_H
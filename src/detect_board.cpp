@@ -17,59 +17,121 @@
 /////////////////////////////////////////////////////////////////////////
 
 #include "detect_board.h"
+#include "color_conversion.h"
 #include "util.h"
 
 namespace bbs
 {
 
-bool DetectBoard::run(cv::Mat const& screen_game, Board &board)
+DetectBoard::DetectBoard()
+  : use_gate_(false)
+  , found_(false)
+  , reused_(false)
+  , incremental_(false)
+  , updated_(false)
+  , first_row_(0)
+  , last_row_(0)
+  , use_palette_(false)
+{
+}
+
+void DetectBoard::setPalette(bool enable)
+{
+  use_palette_ = enable;
+  reset();
+}
+
+void DetectBoard::reset()
+{
+  palette_.clear();
+  gate_.reset();
+  gate_.setRegion(cv::Rect());
+  geometry_.valid = false;
+  probes_.clear();
+  found_ = reused_ = updated_ = false;
+}
+
+void DetectBoard::setGate(bool enable)
 {
-  //  convert to hsv !
-  cv::Mat out(screen_game.size(), CV_8UC3);
-  cv::cvtColor(screen_game, out, CV_RGB2HSV);
+  use_gate_ = enable;
+  reset();
+}
 
-  // split out
-  std::vector<cv::Mat> channel;
-  cv::split(out, channel);
+void DetectBoard::setIncremental(bool enable)
+{
+  incremental_ = enable;
+  reset();
+}
 
-  // we only need hue (shortcut)
-  cv::Mat hue = channel[0];
+bool DetectBoard::settled() const
+{
+  return !use_gate_ || gate_.settled();
+}
+
+void DetectBoard::expectChange()
+{
+  if(use_gate_)
+    gate_.expect();
+}
+
+bool DetectBoard::run(cv::Mat const& screen_game, Board &board)
+{
+  // we only need hue
+  cv::Mat hue;
+  toHue(screen_game, hue);
+
+  // nothing new since the last detection, the board is the same
+  reused_ = updated_ = false;
+  if(use_gate_ && !gate_.update(hue) && found_)
+  {
+    reused_ = true;
+    return true;
+  }
+  // a few balls changed on the same grid
+  if(incremental_ && found_ && update(board, hue))
+  {
+    updated_ = true;
+    if(use_gate_)
+      gate_.accept();
+    return true;
+  }
+  found_ = false;
 
   // clear the board
   board.clear();
+  cells_.clear();
+  probes_.clear();
   board.width = screen_game.size().width;
   board.height = screen_game.size().height;
 
   // this is the player settings
   board.player.point.x = 210;
   board.player.point.y = 346;
-  board.player.type = hue.at<unsigned char>(board.player.point.y, board.player.point.x);
 
-  // looking for the first ball
+  // a ball on the grid of the last frames, or look for one
   Candidate candidate;
-  bool found = false;
-  for(int y=0;y<screen_game.size().height && found == false;y+=20)
+  if(!probeGeometry(board, hue, candidate))
   {
-    for(int x=0;x<screen_game.size().width && found == false;x+=20)
-    {
-      if(findBall(board, hue, candidate, x, y) == true)
-      {
-        if(good_candidate(board, hue, candidate.loc))
-        {
-          // found one, let's go !
-          found = true;
-        }
-      }
-    }
-  }
-  // noone found, return something bad
-  if(! found )
-  {
-    return false;
+    geometry_.valid = false;
+    // noone found, return something bad
+    if(!searchBall(board, hue, candidate))
+      return false;
+    geometry_.valid = true;
+    geometry_.size = hue.size();
+    geometry_.pitch = measurePitch(board, hue, candidate);
   }
+  geometry_.anchor = candidate;
 
   // ok detect all the board based on the first ball
   detectBoard(board, hue, candidate);
+  // after the grid, its balls give the colours
+  board.player.type = playerType(board, hue);
+  first_row_ = last_row_ = 0;
+  for(auto const& probe : probes_)
+  {
+    first_row_ = std::min(first_row_, probe.row);
+    last_row_ = std::max(last_row_, probe.row);
+  }
 
   // reagange the ball :
   //  - sort
@@ -77,21 +139,52 @@ bool DetectBoard::run(cv::Mat const& screen_game, Board &board)
   //  - define score for each ball
   board.rearange();
 
+  if(use_gate_)
+  {
+    // the balls and the player one, not the bottom of the game
+    int bottom = std::min<int>(hue.rows, board.player.point.y + board.radius + 1);
+    gate_.setRegion(cv::Rect(0, 0, hue.cols, bottom));
+    gate_.accept();
+  }
+  found_ = true;
   return true;
 }
 
-double DetectBoard::getPlayerAngle(cv::Mat const& screen_game)
+bool DetectBoard::run(cv::Mat const& screen_game, Board &board, BoardState &state)
 {
-  //  convert to hsv !
-  cv::Mat out(screen_game.size(), CV_8UC3);
-  cv::cvtColor(screen_game, out, CV_RGB2HSV);
-
-  // split out
-  std::vector<cv::Mat> channel;
-  cv::split(out, channel);
+  if(!run(screen_game, board))
+    return false;
+  // the last balls are gone (incremental update), no grid
+  if(cells_.empty())
+    return state.reset(0, 0, 0);
+
+  // the detection grid, moved to start at (0, 0)
+  int row0 = std::numeric_limits<int>::max();
+  int col0 = std::numeric_limits<int>::max();
+  for(auto const& cell : cells_)
+  {
+    row0 = std::min(row0, cell.row);
+    col0 = std::min(col0, cell.col);
+  }
+  int rows, col;
+  board.locate(cv::Point2f(0, board.height), rows, col);
+  int parity = (cells_[0].row - row0 + cells_[0].col - col0) & 1;
+  if(!state.reset(std::max(1, rows + 1), std::max(1, board.grid_columns()), parity))
+    return false;
+  for(auto const& cell : cells_)
+  {
+    if(state.valid(cell.row - row0, cell.col - col0))
+      state.set(cell.row - row0, cell.col - col0, cell.type);
+  }
+  state.drop();
+  return true;
+}
 
-  // we only need hue (shortcut)
-  cv::Mat hue = channel[0];
+double DetectBoard::getPlayerAngle(cv::Mat const& screen_game)
+{
+  // we only need hue
+  cv::Mat hue;
+  toHue(screen_game, hue);
 
   double angle = 0;
   cv::Point player(211, 346);
@@ -113,39 +206,196 @@ double DetectBoard::getPlayerAngle(cv::Mat const& screen_game)
   return angle;
 }
 
+bool DetectBoard::searchBall(Board const& board, cv::Mat const& hue, Candidate & candidate)
+{
+  for(int y=0;y<hue.size().height;y+=20)
+  {
+    for(int x=0;x<hue.size().width;x+=20)
+    {
+      if(findBall(board, hue, candidate, x, y) == true)
+      {
+        if(good_candidate(board, hue, candidate.loc))
+        {
+          // found one, let's go !
+          return true;
+        }
+      }
+    }
+  }
+  return false;
+}
+
+float DetectBoard::measurePitch(Board const& board, cv::Mat const& hue, Candidate const& candidate)
+{
+  // hexagonal packing, unless a neighbor tells better
+  float packed = candidate.radius_y * std::sqrt(3.f);
+  for(int dy=-1;dy<=1;dy+=2)
+  {
+    for(int dx=-1;dx<=1;dx+=2)
+    {
+      cv::Point guess(candidate.loc.x + dx * candidate.radius_x,
+                      candidate.loc.y + dy * int(packed + 0.5f));
+      Candidate n = findArea(hue, guess);
+      if(std::abs(n.radius_x - candidate.radius_x) > 1 || std::abs(n.radius_y - candidate.radius_y) > 1)
+        continue ;
+      if(std::abs(n.loc.x - guess.x) > 1 || !good_candidate(board, hue, n.loc))
+        continue ;
+      return std::abs(n.loc.y - candidate.loc.y);
+    }
+  }
+  return packed;
+}
+
+bool DetectBoard::probeGeometry(Board const& board, cv::Mat const& hue, Candidate & candidate)
+{
+  if(!geometry_.valid || geometry_.size != hue.size())
+    return false;
+  Candidate const& anchor = geometry_.anchor;
+  int step = anchor.radius_x;
+  // the rows around the anchor, both parities (a new row
+  // shifts the others by half a ball)
+  for(int i=0;i<=2*kProbeRows;++i)
+  {
+    int r = (i % 2 ? 1 : -1) * ((i + 1) / 2);
+    int y = anchor.loc.y + int(std::floor(r * geometry_.pitch + 0.5f));
+    int x0 = anchor.loc.x % step;
+    for(int x=x0;x<hue.size().width;x+=step)
+    {
+      if(good_candidate(board, hue, cv::Point(x, y)))
+      {
+        // centered again, the rounding does not add up over frames
+        candidate = anchor;
+        candidate.loc = cv::Point(x, y);
+        Candidate found = findArea(hue, candidate.loc);
+        if(std::abs(found.radius_y - anchor.radius_y) <= 1)
+          candidate.loc.y = found.loc.y;
+        if(std::abs(found.radius_x - anchor.radius_x) <= 1)
+          candidate.loc.x = found.loc.x;
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
 void DetectBoard::detectBoard(Board & board, cv::Mat const& hue, Candidate const& candidate)
 {
   // detect ball for the same row
-  detectRow(board, hue, candidate);
+  detectRow(board, hue, candidate, 0, 0);
 
   Candidate c = candidate;
+  // each row is shifted by half a ball
+  int row = 0;
+  int col = 0;
+  // the farthest rows measured, the pitch is their mean
+  int top = 0;
+  int bottom = 0;
+  cv::Point top_center = candidate.loc;
+  cv::Point bottom_center = candidate.loc;
+  float pitch = geometry_.pitch;
 
   // for each balls below the current line ...
   while(c.loc.y < hue.size().height*0.9)
   {
-    c.loc.y += (candidate.radius_y*2) * 0.87; // magic number :(
+    ++row;
+    c.loc.y = candidate.loc.y + int(std::floor(row * pitch + 0.5f));
     c.loc.x += candidate.radius_x;
-    if(detectRow(board, hue, c) == 0)
+    if(detectRow(board, hue, c, row, ++col) == 0)
       break;
+    if(centerRow(hue, row, candidate, bottom_center))
+    {
+      bottom = row;
+      pitch = float(bottom_center.y - candidate.loc.y) / bottom;
+    }
   }
 
 
   // for each balls upper the current line
   c.loc = candidate.loc;
+  row = col = 0;
   while(c.loc.y > 0)
   {
-    c.loc.y -= (candidate.radius_y*2) * 0.86; // magic number :'(
+    --row;
+    c.loc.y = candidate.loc.y + int(std::floor(row * pitch + 0.5f));
     c.loc.x += candidate.radius_x;
-    if(detectRow(board, hue, c) == 0)
+    if(detectRow(board, hue, c, row, ++col) == 0)
       break;
+    if(centerRow(hue, row, candidate, top_center))
+    {
+      top = row;
+      pitch = float(top_center.y - candidate.loc.y) / top;
+    }
   }
+  if(bottom > top)
+    geometry_.pitch = float(bottom_center.y - top_center.y) / (bottom - top);
 
+  mass_ = c.loc;
   Candidate mass;
-  mass = findArea(hue, cv::Point(c.loc.x, c.loc.y));
+  mass = findArea(hue, mass_);
   if(mass.radius_x > hue.size().width*0.4)
     board.endGame = true;
 }
 
+bool DetectBoard::update(Board & board, cv::Mat const& hue)
+{
+  if(probes_.empty() || hue.size() != cv::Size(board.width, board.height))
+    return false;
+
+  // only the centers whose hue moved are checked again
+  std::vector<std::pair<int, bool> > edits;
+  for(int i=0;i<probes_.size();++i)
+  {
+    Probe & probe = probes_[i];
+    unsigned char h = hue.at<unsigned char>(probe.point.y, probe.point.x);
+    if(h == probe.hue)
+      continue ;
+    bool was = probe.ball;
+    unsigned char type = probe.type;
+    probe.hue = h;
+    probe.ball = detectCell(board, hue, probe.point, probe.type);
+    if(was == probe.ball && (!was || type == probe.type))
+      continue ;
+    // a new ball out of the scanned rows, the board grows
+    if(!was && (probe.row == first_row_ || probe.row == last_row_))
+      return false;
+    edits.push_back(std::make_pair(i, was));
+  }
+  // the whole grid moved (a new row)
+  if(edits.size() > probes_.size() * kMaxEdits)
+    return false;
+
+  board.player.type = playerType(board, hue);
+  Candidate mass = findArea(hue, mass_);
+  board.endGame = mass.radius_x > hue.size().width*0.4;
+  if(edits.empty())
+    return true;
+
+  for(auto const& edit : edits)
+  {
+    Probe const& probe = probes_[edit.first];
+    if(edit.second && probe.ball)
+      board.retype(probe.point, probe.type);
+    else if(edit.second)
+      board.remove(probe.point);
+    else
+      board.add(probe.point, probe.type);
+  }
+  board.rearange();
+
+  cells_.clear();
+  for(auto const& probe : probes_)
+  {
+    if(!probe.ball)
+      continue ;
+    Cell cell;
+    cell.row = probe.row;
+    cell.col = probe.col;
+    cell.type = probe.type;
+    cells_.push_back(cell);
+  }
+  return true;
+}
+
 namespace
 {
 
@@ -183,29 +433,148 @@ bool DetectBoard::good_candidate(Board const& board, cv::Mat const& hue, cv::Poi
       && !pixelon(hue, cv::Point(point.x+board.radius, point.y+board.radius-7), ref);
 }
 
-int DetectBoard::detectRow(Board & board, cv::Mat const& hue, Candidate const& candidate)
+bool DetectBoard::sample(Board const& board, cv::Mat const& hue, cv::Point const& point, unsigned char & type)
+{
+  // point in the picture
+  if(point.x - board.radius < 0 || point.x + board.radius >= hue.size().width
+     || point.y - board.radius < 0 || point.y + board.radius >= hue.size().height)
+    return false;
+  // if not the ball player
+  if(distance(point, board.player.point) < board.radius)
+    return false;
+
+  unsigned char colour = palette_.classify(hue.at<unsigned char>(point.y, point.x));
+  if(colour == 0)
+  {
+    // a new colour, only from a well shaped ball
+    if(!good_candidate(board, hue, point))
+      return false;
+    colour = palette_.learn(hue.at<unsigned char>(point.y, point.x));
+    type = colour;
+    return colour != 0;
+  }
+
+  // the same pattern as good_candidate : four points inside
+  // the ball (one may be off), four outside
+  int r = board.radius;
+  cv::Point inside[4] = {
+    cv::Point(point.x-r/2, point.y-r/2), cv::Point(point.x+r/2, point.y+r/2),
+    cv::Point(point.x-r/2, point.y+r/2), cv::Point(point.x+r/2, point.y-r/2)
+  };
+  cv::Point outside[4] = {
+    cv::Point(point.x-r, point.y-r+7), cv::Point(point.x+r, point.y-r+7),
+    cv::Point(point.x-r, point.y+r-7), cv::Point(point.x+r, point.y+r-7)
+  };
+  int same = 0;
+  for(auto const& p : inside)
+    same += palette_.classify(hue.at<unsigned char>(p.y, p.x)) == colour;
+  if(same < 3)
+    return false;
+  for(auto const& p : outside)
+  {
+    if(palette_.classify(hue.at<unsigned char>(p.y, p.x)) == colour)
+      return false;
+  }
+  type = colour;
+  return true;
+}
+
+bool DetectBoard::detectCell(Board const& board, cv::Mat const& hue, cv::Point const& point, unsigned char & type)
+{
+  if(use_palette_)
+    return sample(board, hue, point, type);
+  if(!good_candidate(board, hue, point))
+    return false;
+  type = hue.at<unsigned char>(point.y, point.x);
+  return true;
+}
+
+unsigned char DetectBoard::playerType(Board const& board, cv::Mat const& hue)
+{
+  cv::Point const& p = board.player.point;
+  unsigned char h = hue.at<unsigned char>(p.y, p.x);
+  if(!use_palette_)
+    return h;
+  unsigned char colour = palette_.classify(h);
+  if(colour)
+    return colour;
+  // a colour not on the grid, only learned from a well shaped ball
+  // (not the background when the player one is missing)
+  int r = board.radius / 2;
+  if(!r || p.x - r < 0 || p.x + r >= hue.cols || p.y - r < 0 || p.y + r >= hue.rows)
+    return 0;
+  if(pixelon(hue, cv::Point(p.x-r, p.y-r), h) && pixelon(hue, cv::Point(p.x+r, p.y+r), h)
+     && pixelon(hue, cv::Point(p.x-r, p.y+r), h) && pixelon(hue, cv::Point(p.x+r, p.y-r), h))
+    return palette_.learn(h);
+  return 0;
+}
+
+int DetectBoard::detectRow(Board & board, cv::Mat const& hue, Candidate const& candidate, int row, int col)
 {
   int how = 0;
-  for(int x=candidate.loc.x;x<hue.size().width;x+=(candidate.radius_x*2))
+  Cell cell;
+  cell.row = row;
+  cell.col = col;
+  for(int x=candidate.loc.x;x<hue.size().width;x+=(candidate.radius_x*2), cell.col+=2)
   {
-    if(good_candidate(board, hue, cv::Point(x, candidate.loc.y)))
+    cv::Point point(x, candidate.loc.y);
+    bool ball = detectCell(board, hue, point, cell.type);
+    addProbe(hue, point, cell, ball);
+    if(ball)
     {
-      board.add(cv::Point(x, candidate.loc.y), hue.at<unsigned char>(candidate.loc.y, x));
+      board.add(point, cell.type);
+      cells_.push_back(cell);
       how ++;
     }
   }
 
-  for(int x=candidate.loc.x-candidate.radius_x*2;x>0;x-=(candidate.radius_x*2))
+  cell.col = col - 2;
+  for(int x=candidate.loc.x-candidate.radius_x*2;x>0;x-=(candidate.radius_x*2), cell.col-=2)
   {
-    if(good_candidate(board, hue, cv::Point(x, candidate.loc.y)))
+    cv::Point point(x, candidate.loc.y);
+    bool ball = detectCell(board, hue, point, cell.type);
+    addProbe(hue, point, cell, ball);
+    if(ball)
     {
-      board.add(cv::Point(x, candidate.loc.y), hue.at<unsigned char>(candidate.loc.y, x));
+      board.add(point, cell.type);
+      cells_.push_back(cell);
       how++;
     }
   }
   return how;
 }
 
+bool DetectBoard::centerRow(cv::Mat const& hue, int row, Candidate const& anchor, cv::Point & center)
+{
+  for(int i=probes_.size()-1;i>=0 && probes_[i].row == row;--i)
+  {
+    if(!probes_[i].ball)
+      continue ;
+    // the vertical extent only, a ball of the same colour
+    // may touch it on the row
+    Candidate found = findArea(hue, probes_[i].point);
+    if(std::abs(found.radius_y - anchor.radius_y) > 1 || std::abs(found.loc.x - probes_[i].point.x) > anchor.radius_x)
+      continue ;
+    center = cv::Point(probes_[i].point.x, found.loc.y);
+    return true;
+  }
+  return false;
+}
+
+void DetectBoard::addProbe(cv::Mat const& hue, cv::Point const& point, Cell const& cell, bool ball)
+{
+  if(point.x < 0 || point.y < 0 || point.x >= hue.cols || point.y >= hue.rows)
+    return ;
+  Probe probe;
+  probe.point = point;
+  probe.row = cell.row;
+  probe.col = cell.col;
+  probe.ball = ball;
+  probe.type = cell.type;
+  probe.hue = hue.at<unsigned char>(point.y, point.x);
+  probes_.push_back(probe);
+}
+
 bool DetectBoard::findBall(Board const& board, cv::Mat const& hue, Candidate & candidate, int x, int y)
 {
   candidate = findArea(hue, cv::Point(x, y));
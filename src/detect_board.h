@@ -22,6 +22,9 @@
 #include <opencv2/opencv.hpp>
 
 #include "board.h"
+#include "board_state.h"
+#include "frame_gate.h"
+#include "palette.h"
 
 namespace bbs
 {
@@ -32,12 +35,72 @@ namespace bbs
 class DetectBoard
 {
 public:
+  DetectBoard();
+
   ////////////////////////////////////////////////////////////
   /// @brief take image and look for balls
-  /// @param screen_game the screen of the game
+  /// @param screen_game the screen of the game (BGR or raw BGRX)
   /// @param board the meta structure of the baord
   ////////////////////////////////////////////////////////////
   bool run(const cv::Mat &screen_game, Board &board);
+
+  ////////////////////////////////////////////////////////////
+  /// @brief forget the last frames (a new game) : the grid
+  ///        geometry is searched again
+  ////////////////////////////////////////////////////////////
+  void reset();
+
+  ////////////////////////////////////////////////////////////
+  /// @brief skip the detection when the balls area has not
+  ///        changed since the last one, the board is kept
+  ///        (the same board must be given to each run)
+  ////////////////////////////////////////////////////////////
+  void setGate(bool enable);
+
+  ////////////////////////////////////////////////////////////
+  /// @brief after a first detection, only probe the cells
+  ///        centers of the grid and edit the balls that changed,
+  ///        the whole image is scanned again when the grid moves
+  ///        (the same board must be given to each run)
+  ////////////////////////////////////////////////////////////
+  void setIncremental(bool enable);
+
+  ////////////////////////////////////////////////////////////
+  /// @brief the type of a ball is a colour of a palette
+  ///        learned on the balls (1, 2, ...) instead of the hue
+  ///        of its center, a cell is a ball when its samples
+  ///        have its colour
+  ////////////////////////////////////////////////////////////
+  void setPalette(bool enable);
+  Palette const& palette() const;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief the last run kept the board
+  ////////////////////////////////////////////////////////////
+  bool reused() const;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief the last run only edited the board
+  ////////////////////////////////////////////////////////////
+  bool updated() const;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief the balls area did not move for a few frames
+  ///        (always true without the gate)
+  ////////////////////////////////////////////////////////////
+  bool settled() const;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief a shot is coming, not settled until it moves
+  ////////////////////////////////////////////////////////////
+  void expectChange();
+
+  ////////////////////////////////////////////////////////////
+  /// @brief same, and fill a state with the grid of the
+  ///        detection (no falling balls)
+  /// @return false if no board or the grid is too big
+  ////////////////////////////////////////////////////////////
+  bool run(const cv::Mat &screen_game, Board &board, BoardState &state);
   double getPlayerAngle(cv::Mat const& screen_game);
 private:
   ///! min angle for shooting
@@ -59,6 +122,65 @@ private:
     int radius_y;
   };
 
+  ///! a detected ball on the grid, relative to the first one
+  struct Cell
+  {
+    int row;
+    int col;
+    unsigned char type;
+  };
+
+  ///! a cell center checked by the last scan
+  struct Probe
+  {
+    cv::Point point;
+    int row;
+    int col;
+    ///! a ball or an empty cell
+    bool ball;
+    unsigned char type;
+    ///! hue at the center
+    unsigned char hue;
+  };
+
+  ///! above this part of the probes changed, scan again
+  constexpr static float kMaxEdits = 0.25;
+
+  ///! hex grid found by the last search
+  struct Geometry
+  {
+    Geometry() : valid(false), pitch(0) {}
+
+    bool valid;
+    ///! a ball center and the radius of the balls
+    Candidate anchor;
+    ///! distance between two rows (mean over the rows found)
+    float pitch;
+    ///! size of the image
+    cv::Size size;
+  };
+
+  ///! rows above and below the anchor probed for a ball
+  constexpr static int kProbeRows = 2;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief look for a first ball on the whole image
+  ////////////////////////////////////////////////////////////
+  bool searchBall(const Board &board, const cv::Mat &hue, Candidate & candidate);
+
+  ////////////////////////////////////////////////////////////
+  /// @brief a ball on the grid of the last search : a few
+  ///        centers around the anchor are checked
+  /// @return false if the geometry has to be estimated again
+  ////////////////////////////////////////////////////////////
+  bool probeGeometry(const Board &board, const cv::Mat &hue, Candidate & candidate);
+
+  ////////////////////////////////////////////////////////////
+  /// @brief distance between two rows, measured on a ball of
+  ///        the next or previous row (else hexagonal packing)
+  ////////////////////////////////////////////////////////////
+  float measurePitch(const Board &board, const cv::Mat &hue, Candidate const& candidate);
+
   ////////////////////////////////////////////////////////////
   /// @brief try to find a ball about the x, y position
   ////////////////////////////////////////////////////////////
@@ -69,22 +191,99 @@ private:
   ////////////////////////////////////////////////////////////
   Candidate findArea(const cv::Mat &hue, cv::Point const& origin);
 
+  ////////////////////////////////////////////////////////////
+  /// @brief is there a ball centered on a point, of which type
+  ///        (the hue of the center, or the palette colour)
+  ////////////////////////////////////////////////////////////
+  bool detectCell(const Board &board, const cv::Mat &hue, cv::Point const& point, unsigned char & type);
+
+  ////////////////////////////////////////////////////////////
+  /// @brief the palette test of a ball : samples classified by
+  ///        the table, a new colour is learned on a ball passing
+  ///        good_candidate
+  ////////////////////////////////////////////////////////////
+  bool sample(const Board &board, const cv::Mat &hue, cv::Point const& point, unsigned char & type);
+
+  ////////////////////////////////////////////////////////////
+  /// @brief type of the player ball, a colour of the grid
+  ///        (with the palette, 0 if it is not a ball)
+  ////////////////////////////////////////////////////////////
+  unsigned char playerType(const Board &board, const cv::Mat &hue);
+
   ////////////////////////////////////////////////////////////
   /// @brief detect all ball on a line
+  /// @param row, col grid position of the candidate
+  ////////////////////////////////////////////////////////////
+  int detectRow(Board &board, const cv::Mat &hue, Candidate const& candidate, int row, int col);
+
+  ////////////////////////////////////////////////////////////
+  /// @brief remember a checked cell center (inside the image)
   ////////////////////////////////////////////////////////////
-  int detectRow(Board &board, const cv::Mat &hue, Candidate const& candidate);
+  void addProbe(const cv::Mat &hue, cv::Point const& point, Cell const& cell, bool ball);
 
   ////////////////////////////////////////////////////////////
-  /// @brief detect the board (treat columns)
+  /// @brief detect the board (treat columns), the pitch is
+  ///        measured again over the rows found
   ////////////////////////////////////////////////////////////
   void detectBoard(Board &board, const cv::Mat &hue, Candidate const& candidate);
 
+  ////////////////////////////////////////////////////////////
+  /// @brief center of a ball of a row just scanned (findArea)
+  /// @return false if no ball of the row has the anchor size
+  ////////////////////////////////////////////////////////////
+  bool centerRow(const cv::Mat &hue, int row, Candidate const& anchor, cv::Point & center);
+
+  ////////////////////////////////////////////////////////////
+  /// @brief edit the board from the probes which changed
+  /// @return false if the grid moved (full detection needed)
+  ////////////////////////////////////////////////////////////
+  bool update(Board &board, const cv::Mat &hue);
+
   ////////////////////////////////////////////////////////////
   /// @brief return true if the point if the center of a ball
   ////////////////////////////////////////////////////////////
   bool good_candidate(const Board &board, cv::Mat const& hue, cv::Point const& point);
+
+  ///! balls of the last run
+  std::vector<Cell> cells_;
+
+  FrameGate gate_;
+  bool use_gate_;
+  ///! result of the last detection
+  bool found_;
+  bool reused_;
+
+  bool incremental_;
+  bool updated_;
+  ///! cells centers of the scanned rows
+  std::vector<Probe> probes_;
+  ///! first and last scanned rows
+  int first_row_;
+  int last_row_;
+  ///! where the mass is looked for
+  cv::Point mass_;
+
+  Geometry geometry_;
+
+  Palette palette_;
+  bool use_palette_;
 };
 
+inline bool DetectBoard::reused() const
+{
+  return reused_;
+}
+
+inline Palette const& DetectBoard::palette() const
+{
+  return palette_;
+}
+
+inline bool DetectBoard::updated() const
+{
+  return updated_;
+}
+
 }
 
 #endif // BB_DETECT_BOARD_H
@@ -22,13 +22,36 @@ namespace bbs
 {
 
 DetectGame::DetectGame()
+  : tracking_(false)
+  , misses_(0)
 {
 }
 
-bool DetectGame::loadMotif(std::string const& motif)
+bool DetectGame::setMotif(cv::Mat const& motif)
 {
-  tmpl_ = cv::imread(motif);
-  return tmpl_.data;
+  tmpl_ = motif;
+  tmpl_pyramid_.clear();
+  if(!tmpl_.data)
+    return false;
+
+  tmpl_pyramid_.push_back(tmpl_);
+  while(tmpl_pyramid_.size() <= kPyramidLevels)
+  {
+    cv::Mat const& last = tmpl_pyramid_.back();
+    if(last.cols / 2 < kMinMotifSize || last.rows / 2 < kMinMotifSize)
+      break;
+    cv::Mat reduced;
+    cv::pyrDown(last, reduced);
+    tmpl_pyramid_.push_back(reduced);
+  }
+  reset();
+  return true;
+}
+
+void DetectGame::reset()
+{
+  tracking_ = false;
+  misses_ = 0;
 }
 
 cv::Rect DetectGame::run(cv::Mat const& screenshot)
@@ -38,36 +61,117 @@ cv::Rect DetectGame::run(cv::Mat const& screenshot)
   if(!tmpl_.data)
     return cv::Rect();
 
-  cv::Mat result;
+  cv::Point matchLoc;
+  bool found = false;
+
+  if(tracking_)
+    found = searchAround(screenshot, matchLoc);
+
+  if(!found && misses_ < kMaxMisses)
+  {
+    found = searchPyramid(screenshot, matchLoc);
+  }
+  else if(!found)
+  {
+    found = searchExhaustive(screenshot, matchLoc);
+    misses_ = 0;
+  }
+
+  if(!found)
+  {
+    misses_++;
+    return cv::Rect();
+  }
 
-  cv::matchTemplate(screenshot, tmpl_, result, CV_TM_SQDIFF_NORMED);
+  last_ = matchLoc;
+  tracking_ = true;
+  misses_ = 0;
 
-  cv::normalize(result, result, 0, 1, cv::NORM_MINMAX, -1, cv::Mat() );
+  return cv::Rect(
+        cv::Point(matchLoc.x+tmpl_.cols, matchLoc.y),
+        cv::Point(matchLoc.x + tmpl_.cols + kGameWidth , matchLoc.y + tmpl_.rows + kGameHeight ));
+}
 
-  double minVal; double maxVal; cv::Point minLoc; cv::Point maxLoc;
-  cv::Point matchLoc;
+bool DetectGame::match(cv::Mat const& image, cv::Mat const& tmpl, cv::Rect area, cv::Point & loc)
+{
+  area = area & cv::Rect(0, 0, image.cols, image.rows);
+  if(area.width < tmpl.cols || area.height < tmpl.rows)
+    return false;
+
+  cv::Mat result;
+  cv::matchTemplate(image(area), tmpl, result, CV_TM_SQDIFF_NORMED);
 
-  cv::minMaxLoc( result, &minVal, &maxVal, &minLoc, &maxLoc, cv::Mat() );
+  double minVal; cv::Point minLoc;
+  cv::minMaxLoc( result, &minVal, 0, &minLoc, 0, cv::Mat() );
 
-  matchLoc = minLoc;
+  loc = area.tl() + minLoc;
+  return true;
+}
+
+bool DetectGame::verify(cv::Mat const& screenshot, cv::Point const& loc)
+{
+  if(loc.x < 0 || loc.y < 0
+     || loc.x + tmpl_.cols > screenshot.cols || loc.y + tmpl_.rows > screenshot.rows)
+    return false;
 
-  cv::Mat sub(screenshot,  cv::Rect(matchLoc,
-                                    cv::Point( matchLoc.x + tmpl_.cols , matchLoc.y + tmpl_.rows )));
+  cv::Mat sub(screenshot, cv::Rect(loc, tmpl_.size()));
 
-  for(int x=0;x<tmpl_.size().width;++x)
+  for(int y=0;y<tmpl_.size().height;++y)
   {
-    for(int y=0;y<tmpl_.size().height;++y)
+    cv::Vec3b const* s = sub.ptr<cv::Vec3b>(y);
+    cv::Vec3b const* t = tmpl_.ptr<cv::Vec3b>(y);
+    for(int x=0;x<tmpl_.size().width;++x)
     {
-      cv::Vec3b diff = sub.at<cv::Vec3b>(y, x)-tmpl_.at<cv::Vec3b>(y, x);
+      cv::Vec3b diff = s[x] - t[x];
       if(abs(diff[0]) < kThreshold && abs(diff[1]) < kThreshold && abs(diff[2]) < kThreshold)
         continue;
-      return cv::Rect();
+      return false;
     }
   }
+  return true;
+}
 
-  return cv::Rect(
-        cv::Point(matchLoc.x+tmpl_.cols, matchLoc.y),
-        cv::Point(matchLoc.x + tmpl_.cols + kGameWidth , matchLoc.y + tmpl_.rows + kGameHeight ));
+bool DetectGame::searchAround(cv::Mat const& screenshot, cv::Point & loc)
+{
+  cv::Rect area(last_.x - kTrackMargin, last_.y - kTrackMargin,
+                tmpl_.cols + 2 * kTrackMargin, tmpl_.rows + 2 * kTrackMargin);
+  return match(screenshot, tmpl_, area, loc) && verify(screenshot, loc);
+}
+
+bool DetectGame::searchPyramid(cv::Mat const& screenshot, cv::Point & loc)
+{
+  int levels = tmpl_pyramid_.size() - 1;
+  if(levels == 0)
+    return searchExhaustive(screenshot, loc);
+
+  std::vector<cv::Mat> pyramid(1, screenshot);
+  for(int i=0;i<levels;++i)
+  {
+    cv::Mat reduced;
+    cv::pyrDown(pyramid.back(), reduced);
+    pyramid.push_back(reduced);
+  }
+
+  // coarse : the whole (small) image
+  if(!match(pyramid[levels], tmpl_pyramid_[levels],
+            cv::Rect(0, 0, pyramid[levels].cols, pyramid[levels].rows), loc))
+    return false;
+
+  // fine : a few pixels around the upscaled location
+  for(int i=levels-1;i>=0;--i)
+  {
+    cv::Mat const& tmpl = tmpl_pyramid_[i];
+    cv::Rect area(loc.x * 2 - 2, loc.y * 2 - 2, tmpl.cols + 4, tmpl.rows + 4);
+    if(!match(pyramid[i], tmpl, area, loc))
+      return false;
+  }
+  return verify(screenshot, loc);
+}
+
+bool DetectGame::searchExhaustive(cv::Mat const& screenshot, cv::Point & loc)
+{
+  return match(screenshot, tmpl_, cv::Rect(0, 0, screenshot.cols, screenshot.rows), loc)
+      && verify(screenshot, loc);
 }
 
 }
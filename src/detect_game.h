@@ -39,14 +39,23 @@ public:
     DetectGame();
 
     ////////////////////////////////////////////////////////////
-    /// @brief load the motif (image ref)
+    /// @brief set the motif (image ref, BGR)
+    /// @return false if it is empty
     ////////////////////////////////////////////////////////////
-    bool loadMotif(std::string const& motif);
+    bool setMotif(cv::Mat const& motif);
 
     ////////////////////////////////////////////////////////////
     /// @brief try to find a source_image similar zone
+    ///        look around the last match first, then use a
+    ///        coarse to fine search, and only after kMaxMisses
+    ///        failures the exhaustive search
     ////////////////////////////////////////////////////////////
     cv::Rect run(cv::Mat const& screenshot);
+
+    ////////////////////////////////////////////////////////////
+    /// @brief forget the last match
+    ////////////////////////////////////////////////////////////
+    void reset();
 private:
     ///! threshold
     constexpr static int kThreshold = 20;
@@ -54,9 +63,50 @@ private:
     constexpr static int kGameWidth = 420;
     ///! game height
     constexpr static int kGameHeight = 290;
+    ///! pixels searched around the last match
+    constexpr static int kTrackMargin = 32;
+    ///! failed searches before trying the exhaustive one
+    constexpr static int kMaxMisses = 3;
+    ///! maximum number of pyramid levels
+    constexpr static int kPyramidLevels = 3;
+    ///! the motif is never reduced below this size
+    constexpr static int kMinMotifSize = 12;
+
+    ////////////////////////////////////////////////////////////
+    /// @brief best match of tmpl inside an area of image
+    ////////////////////////////////////////////////////////////
+    bool match(cv::Mat const& image, cv::Mat const& tmpl, cv::Rect area, cv::Point & loc);
+
+    ////////////////////////////////////////////////////////////
+    /// @brief check pixel by pixel the motif at loc
+    ////////////////////////////////////////////////////////////
+    bool verify(cv::Mat const& screenshot, cv::Point const& loc);
+
+    ////////////////////////////////////////////////////////////
+    /// @brief search in a small window around the last match
+    ////////////////////////////////////////////////////////////
+    bool searchAround(cv::Mat const& screenshot, cv::Point & loc);
+
+    ////////////////////////////////////////////////////////////
+    /// @brief coarse to fine search on an image pyramid
+    ////////////////////////////////////////////////////////////
+    bool searchPyramid(cv::Mat const& screenshot, cv::Point & loc);
+
+    ////////////////////////////////////////////////////////////
+    /// @brief search the whole screenshot at full resolution
+    ////////////////////////////////////////////////////////////
+    bool searchExhaustive(cv::Mat const& screenshot, cv::Point & loc);
 
     ///! instance to keep the motif
     cv::Mat tmpl_;
+    ///! reduced motifs, index 0 is the motif
+    std::vector<cv::Mat> tmpl_pyramid_;
+    ///! position of the motif for the last match
+    cv::Point last_;
+    ///! last_ is meaningful ?
+    bool tracking_;
+    ///! failed searches since the last success
+    int misses_;
 };
 
 }
@@ -52,13 +52,50 @@ namespace bbs
   (b) = (pixel >> _bshift) & _bmask; \
 } while (0)
 
+namespace
+{
+
+#ifdef BBS_WITH_XSHM
+///! set by the error handler when XShmAttach fails (remote display)
+bool shm_error = false;
+
+int shmErrorHandler(Display *, XErrorEvent *)
+{
+  shm_error = true;
+  return 0;
+}
+#endif
+
+////////////////////////////////////////////////////////////
+/// @brief true if the memory layout of the image is already BGRX
+////////////////////////////////////////////////////////////
+bool isBGRX(XImage const* img)
+{
+  return img->bits_per_pixel == 32
+      && img->byte_order == LSBFirst
+      && img->red_mask == 0xff0000
+      && img->green_mask == 0xff00
+      && img->blue_mask == 0xff;
+}
+
+}
+
 DisplayDevice::DisplayDevice()
+  : image_(0)
+  , shm_image_(0)
+  , use_shm_(false)
 {
   display_ = XOpenDisplay( NULL );
+#ifdef BBS_WITH_XSHM
+  use_shm_ = display_ && XShmQueryExtension(display_);
+#endif
 }
 
 DisplayDevice::~DisplayDevice()
 {
+  detachSegment();
+  if(image_)
+    XDestroyImage(image_);
   XCloseDisplay(display_);
 }
 
@@ -74,32 +111,143 @@ cv::Mat DisplayDevice::capture(cv::Rect const& rect)
   return capture(rect.x, rect.y, rect.width, rect.height);
 }
 
+cv::Mat DisplayDevice::captureRaw(cv::Rect const& rect)
+{
+  return grab(rect.x, rect.y, rect.width, rect.height);
+}
+
 cv::Mat DisplayDevice::capture(int x, int y, int width, int height)
 {
-  XImage *img = XGetImage(display_, DefaultRootWindow(display_), x, y, width, height, AllPlanes, ZPixmap);
+  cv::Mat capture;
+  cv::Mat raw = grab(x, y, width, height);
+  if(raw.data)
+    cv::cvtColor(raw, capture, CV_BGRA2BGR);
+  return capture;
+}
+
+cv::Mat DisplayDevice::grab(int x, int y, int width, int height)
+{
+#ifdef BBS_WITH_XSHM
+  if(use_shm_)
+  {
+    if(attachSegment(width, height)
+       && XShmGetImage(display_, DefaultRootWindow(display_), shm_image_, x, y, AllPlanes))
+    {
+      return cv::Mat(height, width, CV_8UC4, shm_image_->data, shm_image_->bytes_per_line);
+    }
+    // the extension does not work here, don't try again
+    detachSegment();
+    use_shm_ = false;
+  }
+#endif
+
+  // very important, don't forget to release memory ;)
+  if(image_)
+    XDestroyImage(image_);
+  image_ = XGetImage(display_, DefaultRootWindow(display_), x, y, width, height, AllPlanes, ZPixmap);
+  if(!image_)
+    return cv::Mat();
+
+  if(isBGRX(image_))
+    return cv::Mat(height, width, CV_8UC4, image_->data, image_->bytes_per_line);
+
+  // exotic visual, convert pixel by pixel
   VARIABLES_DECLARATION;
   InitRGBShiftsAndMasks(16,8,8,8,0,8,0,8);
 
   unsigned long  pixel;
   unsigned	sr, sg, sb;
 
-  cv::Mat capture(height, width, CV_8UC3);
-  for(int i=0;i<width;++i)
+  cv::Mat raw(height, width, CV_8UC4);
+  for(int j=0;j<height;++j)
   {
-    for(int j=0;j<height;++j)
+    cv::Vec4b *row = raw.ptr<cv::Vec4b>(j);
+    for(int i=0;i<width;++i)
     {
-      pixel = XGetPixel( img, i, j);
+      pixel = XGetPixel(image_, i, j);
       PixelToRGB(pixel, sr, sg, sb);
-      capture.at<cv::Vec3b>(j, i)[0] = sb;
-      capture.at<cv::Vec3b>(j, i)[1] = sg;
-      capture.at<cv::Vec3b>(j, i)[2] = sr;
+      row[i][0] = sb;
+      row[i][1] = sg;
+      row[i][2] = sr;
+      row[i][3] = 0;
     }
   }
+  return raw;
+}
 
-  // very important, don't forget to release memory ;)
-  XDestroyImage(img);
+bool DisplayDevice::attachSegment(int width, int height)
+{
+#ifdef BBS_WITH_XSHM
+  if(shm_image_ && shm_image_->width == width && shm_image_->height == height)
+    return true;
+  detachSegment();
+
+  int screen = DefaultScreen(display_);
+  XImage *img = XShmCreateImage(display_, DefaultVisual(display_, screen), DefaultDepth(display_, screen),
+                                ZPixmap, NULL, &shminfo_, width, height);
+  if(!img)
+    return false;
+  if(!isBGRX(img))
+  {
+    XDestroyImage(img);
+    return false;
+  }
 
-  return capture;
+  shminfo_.shmid = shmget(IPC_PRIVATE, img->bytes_per_line * img->height, IPC_CREAT | 0600);
+  if(shminfo_.shmid < 0)
+  {
+    XDestroyImage(img);
+    return false;
+  }
+  shminfo_.shmaddr = static_cast<char*>(shmat(shminfo_.shmid, 0, 0));
+  if(shminfo_.shmaddr == reinterpret_cast<char*>(-1))
+  {
+    // no mapping (limits, permissions) : nobody will release it
+    shmctl(shminfo_.shmid, IPC_RMID, 0);
+    XDestroyImage(img);
+    return false;
+  }
+  img->data = shminfo_.shmaddr;
+  shminfo_.readOnly = False;
+
+  // a remote display only report the failure asynchronously
+  shm_error = false;
+  XErrorHandler previous = XSetErrorHandler(shmErrorHandler);
+  bool attached = XShmAttach(display_, &shminfo_);
+  XSync(display_, False);
+  XSetErrorHandler(previous);
+
+  // the segment will be released when everyone is detached
+  shmctl(shminfo_.shmid, IPC_RMID, 0);
+
+  if(!attached || shm_error)
+  {
+    shmdt(shminfo_.shmaddr);
+    img->data = 0;
+    XDestroyImage(img);
+    return false;
+  }
+  shm_image_ = img;
+  return true;
+#else
+  (void)width;
+  (void)height;
+  return false;
+#endif
+}
+
+void DisplayDevice::detachSegment()
+{
+#ifdef BBS_WITH_XSHM
+  if(!shm_image_)
+    return ;
+  XShmDetach(display_, &shminfo_);
+  shmdt(shminfo_.shmaddr);
+  // the data belongs to the segment, not to xlib
+  shm_image_->data = 0;
+  XDestroyImage(shm_image_);
+  shm_image_ = 0;
+#endif
 }
 
 void DisplayDevice::mouseMoveAndClick(int x, int y)
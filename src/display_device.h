@@ -21,6 +21,11 @@
 
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
+#ifdef BBS_WITH_XSHM
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <X11/extensions/XShm.h>
+#endif
 #include <opencv2/opencv.hpp>
 
 namespace bbs
@@ -47,6 +52,18 @@ public:
   ////////////////////////////////////////////////////////////
   cv::Mat capture(cv::Rect const& rect);
 
+  ////////////////////////////////////////////////////////////
+  /// @brief capture a part of the screen without any conversion
+  ///        the result is a BGRX (CV_8UC4) header on the shared
+  ///        memory segment, it is only valid until the next capture
+  ////////////////////////////////////////////////////////////
+  cv::Mat captureRaw(cv::Rect const& rect);
+
+  ////////////////////////////////////////////////////////////
+  /// @brief true if the MIT-SHM extension is used to grab
+  ////////////////////////////////////////////////////////////
+  bool sharedMemory() const;
+
   ////////////////////////////////////////////////////////////
   /// @brief move the mouse to a position and left click
   ////////////////////////////////////////////////////////////
@@ -57,6 +74,21 @@ private:
   ////////////////////////////////////////////////////////////
   cv::Mat capture(int x, int y, int width, int height);
 
+  ////////////////////////////////////////////////////////////
+  /// @brief grab a specified area in the 32 bits X11 layout
+  ////////////////////////////////////////////////////////////
+  cv::Mat grab(int x, int y, int width, int height);
+
+  ////////////////////////////////////////////////////////////
+  /// @brief (re)create the shared memory image for a size
+  ////////////////////////////////////////////////////////////
+  bool attachSegment(int width, int height);
+
+  ////////////////////////////////////////////////////////////
+  /// @brief release the shared memory image
+  ////////////////////////////////////////////////////////////
+  void detachSegment();
+
   ////////////////////////////////////////////////////////////
   /// @brief move the mouse to x, y
   ////////////////////////////////////////////////////////////
@@ -70,8 +102,25 @@ public:
 
   ///! pointer to the display
   Display * display_;
+
+private:
+  ///! last image returned by XGetImage (fallback path)
+  XImage * image_;
+  ///! image attached to the shared memory segment
+  XImage * shm_image_;
+  ///! MIT-SHM is available and working ?
+  bool use_shm_;
+#ifdef BBS_WITH_XSHM
+  ///! shared memory segment used by XShmGetImage
+  XShmSegmentInfo shminfo_;
+#endif
 };
 
+inline bool DisplayDevice::sharedMemory() const
+{
+  return use_shm_;
+}
+
 }
 
 #endif // BB_DISPLAY_DEVICE_H
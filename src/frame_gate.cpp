@@ -0,0 +1,116 @@
+/////////////////////////////////////////////////////////////////////////
+/// BouncingBallsSolver
+/// Copyright (C) 2014 Jérôme Béchu
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include <cstdlib>
+
+#include "frame_gate.h"
+
+namespace bbs
+{
+
+FrameGate::FrameGate()
+  : quiet_(0)
+  , waiting_(0)
+{
+}
+
+void FrameGate::setRegion(cv::Rect const& region)
+{
+  region_ = region;
+}
+
+unsigned FrameGate::sad(unsigned char const* a, unsigned char const* b, int n)
+{
+  unsigned sum = 0;
+  int x = 0;
+#if defined(__SSE2__)
+  // 16 pixels at a time, two partial sums of 8
+  __m128i acc = _mm_setzero_si128();
+  for(;x+16<=n;x+=16)
+  {
+    __m128i va = _mm_loadu_si128(reinterpret_cast<__m128i const*>(a + x));
+    __m128i vb = _mm_loadu_si128(reinterpret_cast<__m128i const*>(b + x));
+    acc = _mm_add_epi64(acc, _mm_sad_epu8(va, vb));
+  }
+  sum = _mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+#endif
+  for(;x<n;++x)
+    sum += std::abs(a[x] - b[x]);
+  return sum;
+}
+
+bool FrameGate::differ(cv::Mat const& a, cv::Mat const& b) const
+{
+  if(a.size() != b.size() || a.type() != b.type())
+    return true;
+  cv::Rect region = region_.area() > 0 ? region_ & cv::Rect(0, 0, a.cols, a.rows)
+                                       : cv::Rect(0, 0, a.cols, a.rows);
+  int n = region.width * a.elemSize();
+  for(int y=region.y;y<region.y+region.height;y+=kRowStep)
+  {
+    if(sad(a.ptr(y) + region.x * a.elemSize(), b.ptr(y) + region.x * b.elemSize(), n) > kThreshold)
+      return true;
+  }
+  return false;
+}
+
+bool FrameGate::update(cv::Mat const& plane)
+{
+  if(!previous_.empty() && !differ(plane, previous_))
+  {
+    quiet_++;
+    if(waiting_ > 0)
+      waiting_--;
+  }
+  else
+  {
+    quiet_ = 0;
+    waiting_ = 0;
+  }
+  // keep the buffer, no allocation once the size is known
+  plane.copyTo(previous_);
+  return reference_.empty() || differ(plane, reference_);
+}
+
+void FrameGate::accept()
+{
+  previous_.copyTo(reference_);
+}
+
+void FrameGate::reset()
+{
+  previous_.release();
+  reference_.release();
+  quiet_ = 0;
+  waiting_ = 0;
+}
+
+void FrameGate::expect()
+{
+  waiting_ = kPatience;
+}
+
+bool FrameGate::settled() const
+{
+  return waiting_ == 0 && quiet_ >= kSettleFrames;
+}
+
+}
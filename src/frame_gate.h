@@ -0,0 +1,107 @@
+/////////////////////////////////////////////////////////////////////////
+/// BouncingBallsSolver
+/// Copyright (C) 2014 Jérôme Béchu
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////
+
+#ifndef BBS_FRAME_GATE_H
+#define BBS_FRAME_GATE_H
+
+#include <opencv2/opencv.hpp>
+
+namespace bbs
+{
+
+////////////////////////////////////////////////////////////
+/// @brief cheap change detector on an 8 bits plane (hue) :
+///      - changed : the frame differs from the reference one
+///        (the frame of the last detection)
+///      - settled : nothing moved during a few frames
+///      two frames differ when a row (one out of kRowStep)
+///      of the region has a sum of absolute differences
+///      above the threshold
+////////////////////////////////////////////////////////////
+class FrameGate
+{
+public:
+  FrameGate();
+
+  ////////////////////////////////////////////////////////////
+  /// @brief part of the frame compared (empty : all of it)
+  ////////////////////////////////////////////////////////////
+  void setRegion(cv::Rect const& region);
+
+  ////////////////////////////////////////////////////////////
+  /// @brief take a new frame
+  /// @return true if it differs from the reference (or there
+  ///         is no reference)
+  ////////////////////////////////////////////////////////////
+  bool update(cv::Mat const& plane);
+
+  ////////////////////////////////////////////////////////////
+  /// @brief the last frame becomes the reference
+  ////////////////////////////////////////////////////////////
+  void accept();
+
+  ////////////////////////////////////////////////////////////
+  /// @brief forget the frames
+  ////////////////////////////////////////////////////////////
+  void reset();
+
+  ////////////////////////////////////////////////////////////
+  /// @brief something is going to move (a shot) : not settled
+  ///        until a motion is seen, or after kPatience frames
+  ////////////////////////////////////////////////////////////
+  void expect();
+
+  ////////////////////////////////////////////////////////////
+  /// @brief no motion during the last kSettleFrames frames ?
+  ////////////////////////////////////////////////////////////
+  bool settled() const;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief sum of absolute differences of a row
+  ////////////////////////////////////////////////////////////
+  static unsigned sad(unsigned char const* a, unsigned char const* b, int n);
+
+private:
+  ///! one row out of kRowStep is compared
+  constexpr static int kRowStep = 2;
+  ///! sum of absolute differences of a changed row
+  constexpr static unsigned kThreshold = 64;
+  ///! frames without motion of a settled board
+  constexpr static int kSettleFrames = 2;
+  ///! frames waiting for an expected motion
+  constexpr static int kPatience = 100;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief true if a row of the region differs
+  ////////////////////////////////////////////////////////////
+  bool differ(cv::Mat const& a, cv::Mat const& b) const;
+
+  cv::Rect region_;
+  ///! the last frame
+  cv::Mat previous_;
+  ///! the frame of the last detection
+  cv::Mat reference_;
+  ///! frames without motion
+  int quiet_;
+  ///! frames left to see an expected motion (0 : none expected)
+  int waiting_;
+};
+
+}
+
+#endif // BBS_FRAME_GATE_H
@@ -0,0 +1,292 @@
+/////////////////////////////////////////////////////////////////////////
+/// BouncingBallsSolver
+/// Copyright (C) 2014 Jérôme Béchu
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+
+#include "lookahead.h"
+#include "zobrist.h"
+
+namespace bbs
+{
+
+Lookahead::Lookahead(Solver & solver)
+  : solver_(solver)
+  , danger_row_(0)
+  , expired_(false)
+  , depth_(0)
+  , nodes_(0)
+  , table_(settings_.table)
+  , decisions_(settings_.decisions)
+{
+  beams_.assign(settings_.depth + 1, std::vector<Move>(settings_.beam));
+}
+
+void Lookahead::setSettings(Settings const& settings)
+{
+  settings_ = settings;
+  // the values depend on the settings
+  table_.clear();
+  table_.setCapacity(settings.table);
+  decisions_.clear();
+  decisions_.setCapacity(settings.decisions);
+  beams_.assign(std::max(0, settings.depth) + 1, std::vector<Move>(std::max(0, settings.beam)));
+}
+
+bool Lookahead::attach(Board const& board, BoardState const& state, cv::Point2f const& hit, int & row, int & col) const
+{
+  int r, c;
+  board.locate(hit, r, c);
+  r = std::max(0, std::min(state.rows() - 1, r));
+  c = std::max(0, std::min(state.cols() - 1, c));
+
+  // the closest empty cell around the hit point
+  float best = std::numeric_limits<float>::max();
+  for(int y=r-1;y<=r+1;++y)
+  {
+    for(int x=c-2;x<=c+2;++x)
+    {
+      if(!state.valid(y, x) || state.at(y, x))
+        continue ;
+      cv::Point2f d = board.center(y, x) - hit;
+      float distance = d.dot(d);
+      if(distance < best)
+      {
+        best = distance;
+        row = y;
+        col = x;
+      }
+    }
+  }
+  return best != std::numeric_limits<float>::max();
+}
+
+float Lookahead::reward(int removed, int row) const
+{
+  if(removed > 0)
+    return removed;
+  // the ball stays, too low and the game is lost
+  return row >= danger_row_ ? -100 : 0;
+}
+
+bool Lookahead::expired()
+{
+  if(!expired_ && (nodes_ & 63) == 0 && Clock::now() > deadline_)
+    expired_ = true;
+  return expired_;
+}
+
+float Lookahead::expand(BoardState const& state, unsigned char type, int depth)
+{
+  nodes_++;
+  if(expired())
+    return 0;
+  uint64_t key = state.hash() ^ zobrist::tagged(zobrist::kPlayer, type)
+               ^ zobrist::tagged(zobrist::kDepth, depth);
+  float const* known = table_.find(key);
+  if(known)
+    return *known;
+
+  BoardState::RowMask open[BoardState::kRows];
+  state.open(open);
+  // the shots are only scored, the best ones are kept (best first)
+  std::vector<Move> & beam = beams_[depth];
+  int size = depth > 1 ? beam.size() : 0;
+  int kept = 0;
+  bool found = false;
+  float best = -std::numeric_limits<float>::max();
+  for(int r=0;r<state.rows();++r)
+  {
+    for(BoardState::RowMask m = open[r]; m; bitboard::pop(m))
+    {
+      int c = bitboard::lowest(m);
+      float value = reward(state.removed(r, c, type), r);
+      found = true;
+      if(depth <= 1)
+      {
+        best = std::max(best, value);
+        continue ;
+      }
+      if(kept < size)
+        kept++;
+      else if(kept == 0 || value <= beam[kept-1].reward)
+        continue ;
+      int i = kept - 1;
+      for(;i>0 && beam[i-1].reward < value;--i)
+      {
+        beam[i].row = beam[i-1].row;
+        beam[i].col = beam[i-1].col;
+        beam[i].reward = beam[i-1].reward;
+      }
+      beam[i].row = r;
+      beam[i].col = c;
+      beam[i].reward = value;
+    }
+  }
+  // no open cell, nothing to win
+  if(!found)
+    best = 0;
+  if(depth <= 1 || kept == 0)
+  {
+    table_.insert(key, best);
+    return best;
+  }
+
+  // only the kept shots are played
+  for(int i=0;i<kept;++i)
+  {
+    Move & move = beam[i];
+    move.next = state;
+    move.next.place(move.row, move.col, type);
+    float value = move.reward + settings_.discount * chance(move.next, depth - 1);
+    best = std::max(best, value);
+  }
+  // a part is missing once the budget is spent
+  if(!expired_)
+    table_.insert(key, best);
+  return best;
+}
+
+float Lookahead::chance(BoardState const& state, int depth)
+{
+  if(depth <= 0)
+    return 0;
+  bool present[256];
+  // an empty board, nothing more to win
+  if(state.types(present) == 0)
+    return 0;
+
+  float sum = 0;
+  int types = 0;
+  for(int t=1;t<256;++t)
+  {
+    if(!present[t])
+      continue ;
+    sum += expand(state, t, depth);
+    types++;
+  }
+  return sum / types;
+}
+
+Solver::Solution Lookahead::run(Board const& board)
+{
+  uint64_t key = board.hash();
+  Solver::Solution const* known = decisions_.find(key);
+  if(known)
+  {
+    depth_ = 0;
+    nodes_ = 0;
+    return *known;
+  }
+
+  Solver::Solution solution = search(board);
+  // a random angle, the next frame tries another one
+  if(solver_.solutions().empty())
+    return solution;
+  // the balls belong to this board only
+  Solver::Solution kept = solution;
+  kept.balls.clear();
+  kept.target = 0;
+  decisions_.insert(key, kept);
+  return solution;
+}
+
+Solver::Solution Lookahead::search(Board const& board)
+{
+  Solver::Solution greedy = solver_.solve(board);
+  std::vector<Solver::Solution> const& solutions = solver_.solutions();
+  depth_ = 0;
+  nodes_ = 0;
+  expired_ = false;
+  deadline_ = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>(settings_.budget));
+  if(solutions.empty())
+    return greedy;
+
+  BoardState root;
+  if(!board.exportState(root))
+    return greedy;
+  int danger, col;
+  board.locate(cv::Point2f(0, board.height * 0.8), danger, col);
+  // the rewards depend on it
+  if(danger != danger_row_)
+    table_.clear();
+  danger_row_ = danger;
+
+  // one shot per cell, the fewer rebounds the better
+  std::vector<int> index;
+  std::vector<Move> moves;
+  for(int i=0;i<solutions.size();++i)
+  {
+    Move move;
+    if(!attach(board, root, solutions[i].hit, move.row, move.col))
+      continue ;
+    auto same = std::find_if(moves.begin(), moves.end(), [&](Move const& m)
+    {
+      return m.row == move.row && m.col == move.col;
+    });
+    if(same != moves.end())
+    {
+      int & j = index[same - moves.begin()];
+      if(solutions[i].rebound < solutions[j].rebound)
+        j = i;
+      continue ;
+    }
+    move.next = root;
+    move.reward = reward(move.next.place(move.row, move.col, board.player.type), move.row);
+    moves.push_back(move);
+    index.push_back(i);
+  }
+  if(moves.empty())
+    return greedy;
+
+  // iterative deepening, an unfinished depth is thrown away
+  std::vector<float> values(moves.size());
+  std::vector<float> deeper(moves.size());
+  for(int i=0;i<moves.size();++i)
+    values[i] = moves[i].reward;
+  depth_ = 1;
+  for(int depth=2;depth<=settings_.depth;++depth)
+  {
+    for(int i=0;i<moves.size() && !expired_;++i)
+      deeper[i] = moves[i].reward + settings_.discount * chance(moves[i].next, depth - 1);
+    if(expired_)
+      break ;
+    values.swap(deeper);
+    depth_ = depth;
+  }
+
+  int best = 0;
+  for(int i=1;i<moves.size();++i)
+  {
+    if(values[i] > values[best])
+      best = i;
+  }
+  // keep the greedy choice unless something is better
+  Move shot;
+  if(attach(board, root, greedy.hit, shot.row, shot.col))
+  {
+    for(int i=0;i<moves.size();++i)
+    {
+      if(moves[i].row == shot.row && moves[i].col == shot.col && values[i] >= values[best])
+        return greedy;
+    }
+  }
+  return solutions[index[best]];
+}
+
+}
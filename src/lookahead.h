@@ -0,0 +1,187 @@
+/////////////////////////////////////////////////////////////////////////
+/// BouncingBallsSolver
+/// Copyright (C) 2014 Jérôme Béchu
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////
+
+#ifndef BBS_LOOKAHEAD_H
+#define BBS_LOOKAHEAD_H
+
+#include <chrono>
+
+#include "board_state.h"
+#include "lru_cache.h"
+#include "solver.h"
+
+namespace bbs
+{
+
+////////////////////////////////////////////////////////////
+/// @brief search a few shots ahead (expectimax) :
+///      - the shots of the player ball are the solutions of
+///        the solver (real trajectories)
+///      - the next balls have an unknown type, every type
+///        still on the board is equally likely
+///      - their shots are the open cells of the simulated
+///        board, only the best ones are expanded (beam)
+///      the depth grows while the time budget allows it
+////////////////////////////////////////////////////////////
+class Lookahead
+{
+public:
+  ///! search settings
+  struct Settings
+  {
+    Settings()
+      : depth(3)
+      , beam(6)
+      , budget(0.015)
+      , discount(0.9f)
+      , table(1 << 16)
+      , decisions(64)
+    {
+    }
+
+    ///! maximum number of shots (the player one included)
+    int depth;
+    ///! number of shots expanded after the first one
+    int beam;
+    ///! time for one run (seconds)
+    double budget;
+    ///! weight of the next shots
+    float discount;
+    ///! evaluated (state, ball, depth) remembered (0 : none)
+    std::size_t table;
+    ///! boards whose choice is remembered (0 : none)
+    std::size_t decisions;
+  };
+
+  ////////////////////////////////////////////////////////////
+  /// @brief the solver gives the shots of the player ball
+  ////////////////////////////////////////////////////////////
+  explicit Lookahead(Solver & solver);
+
+  void setSettings(Settings const& settings);
+  Settings const& settings() const;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief choose a solution (the greedy one if nothing is
+  ///        better or without solutions)
+  ///        a board already seen (same hash) reuses its choice
+  ///        (but not a random angle, when nothing is found)
+  ////////////////////////////////////////////////////////////
+  Solver::Solution run(Board const& board);
+
+  ////////////////////////////////////////////////////////////
+  /// @brief transposition table and decisions cache
+  ////////////////////////////////////////////////////////////
+  LruCache<uint64_t, float> const& table() const;
+  LruCache<uint64_t, Solver::Solution> const& decisions() const;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief depth fully searched and nodes visited by the last run
+  ////////////////////////////////////////////////////////////
+  int depth() const;
+  int nodes() const;
+
+private:
+  typedef std::chrono::steady_clock Clock;
+
+  ///! a shot on the simulated board (next : only once kept)
+  struct Move
+  {
+    int row;
+    int col;
+    float reward;
+    BoardState next;
+  };
+
+  ////////////////////////////////////////////////////////////
+  /// @brief run without the decisions cache
+  ////////////////////////////////////////////////////////////
+  Solver::Solution search(Board const& board);
+
+  ////////////////////////////////////////////////////////////
+  /// @brief empty cell where a shot from a hit point stops
+  ////////////////////////////////////////////////////////////
+  bool attach(Board const& board, BoardState const& state, cv::Point2f const& hit, int & row, int & col) const;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief value of a shot, reward of the simulation
+  ////////////////////////////////////////////////////////////
+  float reward(int removed, int row) const;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief best value with a ball of a known type
+  ////////////////////////////////////////////////////////////
+  float expand(BoardState const& state, unsigned char type, int depth);
+
+  ////////////////////////////////////////////////////////////
+  /// @brief mean value over the type of the next ball
+  ////////////////////////////////////////////////////////////
+  float chance(BoardState const& state, int depth);
+
+  ////////////////////////////////////////////////////////////
+  /// @brief true once the budget is spent (checked by nodes)
+  ////////////////////////////////////////////////////////////
+  bool expired();
+
+  Solver & solver_;
+  Settings settings_;
+
+  ///! below this row, the game is lost
+  int danger_row_;
+  Clock::time_point deadline_;
+  bool expired_;
+  int depth_;
+  int nodes_;
+
+  ///! best shots of each depth, reused by all the nodes
+  std::vector<std::vector<Move> > beams_;
+
+  ///! values of expand, complete ones only
+  LruCache<uint64_t, float> table_;
+  ///! board hash -> chosen solution
+  LruCache<uint64_t, Solver::Solution> decisions_;
+};
+
+inline Lookahead::Settings const& Lookahead::settings() const
+{
+  return settings_;
+}
+
+inline LruCache<uint64_t, float> const& Lookahead::table() const
+{
+  return table_;
+}
+
+inline LruCache<uint64_t, Solver::Solution> const& Lookahead::decisions() const
+{
+  return decisions_;
+}
+
+inline int Lookahead::depth() const
+{
+  return depth_;
+}
+
+inline int Lookahead::nodes() const
+{
+  return nodes_;
+}
+
+}
+
+#endif // BBS_LOOKAHEAD_H
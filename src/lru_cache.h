@@ -0,0 +1,128 @@
+/////////////////////////////////////////////////////////////////////////
+/// BouncingBallsSolver
+/// Copyright (C) 2014 Jérôme Béchu
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////
+
+#ifndef BBS_LRU_CACHE_H
+#define BBS_LRU_CACHE_H
+
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+namespace bbs
+{
+
+////////////////////////////////////////////////////////////
+/// @brief a bounded map, the least recently used entry goes
+///        away when it is full, hits and misses are counted
+///        a capacity of 0 disables the cache
+////////////////////////////////////////////////////////////
+template<typename Key, typename Value>
+class LruCache
+{
+public:
+  explicit LruCache(std::size_t capacity = 0)
+    : capacity_(capacity)
+    , hits_(0)
+    , misses_(0)
+  {
+  }
+
+  ////////////////////////////////////////////////////////////
+  /// @brief change the capacity, the oldest entries go away
+  ////////////////////////////////////////////////////////////
+  void setCapacity(std::size_t capacity)
+  {
+    capacity_ = capacity;
+    trim();
+  }
+
+  std::size_t capacity() const { return capacity_; }
+  std::size_t size() const { return index_.size(); }
+  uint64_t hits() const { return hits_; }
+  uint64_t misses() const { return misses_; }
+
+  ////////////////////////////////////////////////////////////
+  /// @brief the value of a key (now the most recent), or null
+  ////////////////////////////////////////////////////////////
+  Value const* find(Key const& key)
+  {
+    if(capacity_ == 0)
+      return 0;
+    auto it = index_.find(key);
+    if(it == index_.end())
+    {
+      misses_++;
+      return 0;
+    }
+    hits_++;
+    items_.splice(items_.begin(), items_, it->second);
+    return &it->second->second;
+  }
+
+  ////////////////////////////////////////////////////////////
+  /// @brief add or replace a value
+  ////////////////////////////////////////////////////////////
+  void insert(Key const& key, Value const& value)
+  {
+    if(capacity_ == 0)
+      return ;
+    auto it = index_.find(key);
+    if(it != index_.end())
+    {
+      it->second->second = value;
+      items_.splice(items_.begin(), items_, it->second);
+      return ;
+    }
+    items_.push_front(std::make_pair(key, value));
+    index_[key] = items_.begin();
+    trim();
+  }
+
+  ////////////////////////////////////////////////////////////
+  /// @brief remove all the entries (not the counters)
+  ////////////////////////////////////////////////////////////
+  void clear()
+  {
+    items_.clear();
+    index_.clear();
+  }
+
+private:
+  typedef std::list<std::pair<Key, Value> > List;
+
+  void trim()
+  {
+    while(index_.size() > capacity_)
+    {
+      index_.erase(items_.back().first);
+      items_.pop_back();
+    }
+  }
+
+  ///! most recent first
+  List items_;
+  std::unordered_map<Key, typename List::iterator> index_;
+  std::size_t capacity_;
+  uint64_t hits_;
+  uint64_t misses_;
+};
+
+}
+
+#endif // BBS_LRU_CACHE_H
@@ -16,37 +16,74 @@
 /// along with this program.  If not, see <http://www.gnu.org/licenses/>.
 /////////////////////////////////////////////////////////////////////////
 
-#include <unistd.h> // usleep
+#include <cstring>
 
 #include "display_device.h"
 #include "detect_game.h"
-#include "detect_board.h"
-#include "solver.h"
+#include "pipeline.h"
+#include "replay.h"
 
-int main()
+namespace
 {
+
+void usage(char const* name)
+{
+  std::cerr << "usage : " << name << " [--lookahead] [--record <dir>]" << std::endl
+            << "        " << name << " [--lookahead] --replay <dir>" << std::endl
+            << "  --lookahead     search several shots ahead" << std::endl
+            << "  --record <dir>  save the game frames as <dir>/N.png" << std::endl
+            << "  --replay <dir>  run the detection and the solver on recorded" << std::endl
+            << "                  frames, without display nor mouse" << std::endl;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+  bool lookahead = false;
+  std::string record;
+  std::string replay;
+  for(int i=1;i<argc;++i)
+  {
+    if(std::strcmp(argv[i], "--lookahead") == 0)
+      lookahead = true;
+    else if(std::strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+      record = argv[++i];
+    else if(std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+      replay = argv[++i];
+    else
+    {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  // headless, no X11 connection
+  if(!replay.empty())
+  {
+    bbs::Replay player(replay);
+    player.setLookahead(lookahead);
+    if(player.run(std::cout) == 0)
+    {
+      std::cerr << "no frame in " << replay << std::endl;
+      return 1;
+    }
+    return 0;
+  }
+
   // initialize the opencv random seed
   cv::theRNG().state = time(NULL);
   // instance use to take screenshot and control the mouse
   bbs::DisplayDevice display_device;
   // use to detect the area of the game
   bbs::DetectGame game_detector;
-  try
-  {
-      game_detector.loadMotif("motif.png");
-  }
-  catch( ... )
-  {
-      std::cerr<<"motif.png not found ..."<<std::endl;
-  }
+  if(!game_detector.setMotif(cv::imread("motif.png")))
+    std::cerr<<"motif.png not found ..."<<std::endl;
 
-  // convert the image to a board instance
-  bbs::DetectBoard board_detector;
-  // take decisions
-  bbs::Solver solver;
-  // the current board
-  bbs::Board board;
-  bbs::Solver::Solution solution;
+  // capture / detect & solve / act, each one in its thread
+  bbs::Pipeline pipeline;
+  pipeline.setLookahead(lookahead);
+  pipeline.setRecord(record);
 
   while(1)
   {
@@ -57,80 +94,24 @@ int main()
     // found something ...
     if(game_rect.area() > 0)
     {
-      while(1)
+      pipeline.start(game_rect);
+      int frames = 0;
+      cv::Mat debug;
+      // until the board is lost
+      while(pipeline.running())
       {
-
-        cv::Mat screenshot = display_device.capture(game_rect);
-        cv::imwrite("/home/jerome/test.png", screenshot);
-
-        if(board_detector.run(screenshot, board) == false)
+        if(pipeline.popDebug(debug))
         {
-          break;
+          cv::imshow("game", debug);
+          if(++frames % 100 == 0)
+            std::cout << pipeline.stats();
         }
-        // take a decision !
-        solution = solver.run(board);
-
-        //// and apply
-        display_device.mouseMoveAndClick(
-              game_rect.x + board.player.point.x + 100 * std::cos(solution.angle),
-              game_rect.y + board.player.point.y + 100 * std::sin(solution.angle));
-
-              usleep(10000);
-       screenshot = display_device.capture(game_rect);
-       display_device.click();
-
-       board.drawBall(screenshot);
-       solver.draw(screenshot, solution, board);
-       cv::imshow("game", screenshot);
-       cv::waitKey(1);
-       //// cv::imwrite(ss.str(), screenshot);
-        //int overloop = 0;
-        //while(1)
-        //{
-        //    screenshot = display_device.capture(game_rect);
-        //  double angle = board_detector.getPlayerAngle(screenshot);
-       //// std::stringstream ss;
-       //// ss << "./out/"<<counter++<<".png";
-       //// board.drawBall(screenshot);
-       //// solver.draw(screenshot, solution, board);
-       //// cv::imwrite(ss.str(), screenshot);
-        //  if(std::fabs(solution.angle-angle) < 0.1)
-        //    break;
-        //  usleep(20);
-        //  if(overloop++ > 15)
-        //  {
-        //    std::cerr<<"oups error angle ..."<<std::endl;
-        //    std::cerr<<"solution angle : "<<solution.angle<<" and target angle :"<<angle<<std::endl;
-        //    break;
-        //  }
-        //}
-        //
+        cv::waitKey(1);
       }
+      pipeline.stop();
+      std::cout << pipeline.stats();
     }
     cv::waitKey(1000);
   }
   return 0;
 }
-
-//  int c = 0;
-//  while(0)
-//  {
-//    cv::Mat src;
-//    std::stringstream ss;
-//    //if(board.run(screenshot, 0) == false) break;
-//    ss << "./out/" << c << ".png";
-//    src = cv::imread(ss.str());
-//    std::cout<<ss.str()<<std::endl;
-//    board_detector.run(src, board);
-//    //bbs::Solver::Solution solution = solver.run(board);
-//    board.drawBall(src);
-//    //solver.draw(src, solution, board);
-//    cv::imshow("board", src);
-//    int u = cv::waitKey(0);
-//    if(u == 1113937)
-//      c--;
-//    if(u == 1113939)
-//      c++;
-//    if(u == 1048603)
-//      return 0;
-//  }
@@ -0,0 +1,68 @@
+/////////////////////////////////////////////////////////////////////////
+/// BouncingBallsSolver
+/// Copyright (C) 2014 Jérôme Béchu
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////
+
+#include <cstring>
+
+#include "palette.h"
+
+namespace bbs
+{
+
+namespace
+{
+
+///! number of hues of an 8 bits hue plane
+const int kHues = 180;
+
+}
+
+Palette::Palette()
+{
+  clear();
+}
+
+void Palette::clear()
+{
+  std::memset(table_, 0, sizeof(table_));
+  hues_.clear();
+}
+
+unsigned char Palette::learn(unsigned char hue)
+{
+  if(table_[hue])
+    return table_[hue];
+  if(hues_.size() >= kMaxColours)
+    return 0;
+  hues_.push_back(hue);
+  unsigned char colour = hues_.size();
+  if(hue >= kHues)
+  {
+    table_[hue] = colour;
+    return colour;
+  }
+  // a hue already taken keeps its colour
+  for(int d=-kTolerance;d<=kTolerance;++d)
+  {
+    int h = (hue + d + kHues) % kHues;
+    if(!table_[h])
+      table_[h] = colour;
+  }
+  return colour;
+}
+
+}
@@ -0,0 +1,92 @@
+/////////////////////////////////////////////////////////////////////////
+/// BouncingBallsSolver
+/// Copyright (C) 2014 Jérôme Béchu
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////
+
+#ifndef BBS_PALETTE_H
+#define BBS_PALETTE_H
+
+#include <vector>
+
+namespace bbs
+{
+
+////////////////////////////////////////////////////////////
+/// @brief ball colours learned from the hue of the balls :
+///        a 256 entries table gives the colour of a hue,
+///        each colour covers kTolerance hues around the
+///        first one seen (the hue wraps at 180)
+///        colours are 1, 2, ... and 0 is no colour
+////////////////////////////////////////////////////////////
+class Palette
+{
+public:
+  ///! maximum number of colours
+  static const int kMaxColours = 16;
+  ///! hues around a colour
+  static const int kTolerance = 3;
+
+  Palette();
+
+  ////////////////////////////////////////////////////////////
+  /// @brief forget all the colours
+  ////////////////////////////////////////////////////////////
+  void clear();
+
+  ////////////////////////////////////////////////////////////
+  /// @brief colour of a hue (0 : unknown)
+  ////////////////////////////////////////////////////////////
+  unsigned char classify(unsigned char hue) const;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief colour of a hue, a new one if it is unknown
+  /// @return 0 if the palette is full
+  ////////////////////////////////////////////////////////////
+  unsigned char learn(unsigned char hue);
+
+  ////////////////////////////////////////////////////////////
+  /// @brief number of colours
+  ////////////////////////////////////////////////////////////
+  int size() const;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief hue of a colour (the first one seen)
+  ////////////////////////////////////////////////////////////
+  unsigned char hue(unsigned char colour) const;
+
+private:
+  unsigned char table_[256];
+  std::vector<unsigned char> hues_;
+};
+
+inline unsigned char Palette::classify(unsigned char hue) const
+{
+  return table_[hue];
+}
+
+inline int Palette::size() const
+{
+  return hues_.size();
+}
+
+inline unsigned char Palette::hue(unsigned char colour) const
+{
+  return hues_[colour - 1];
+}
+
+}
+
+#endif // BBS_PALETTE_H
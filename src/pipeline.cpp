@@ -0,0 +1,310 @@
+/////////////////////////////////////////////////////////////////////////
+/// BouncingBallsSolver
+/// Copyright (C) 2014 Jérôme Béchu
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////
+
+#include <unistd.h> // usleep
+#include <sstream>
+
+#include "pipeline.h"
+
+namespace bbs
+{
+
+namespace
+{
+
+void idle(int microseconds)
+{
+  std::this_thread::sleep_for(std::chrono::microseconds(microseconds));
+}
+
+Pipeline::Depth depth(std::size_t current, std::size_t high, std::size_t capacity)
+{
+  Pipeline::Depth d;
+  d.current = current;
+  d.high = high;
+  d.capacity = capacity;
+  return d;
+}
+
+}
+
+Pipeline::Pipeline()
+  : running_(false)
+  , lookahead_(solver_)
+  , use_lookahead_(false)
+  , recorded_(0)
+  , frames_(kFrameQueue)
+  , shots_(kShotQueue)
+  , debug_(kDebugQueue)
+  , records_(kRecordQueue)
+  , dropped_(0)
+  , unrecorded_(0)
+  , cache_hits_(0)
+  , cache_misses_(0)
+  , reused_(0)
+  , updated_(0)
+  , moving_(0)
+{
+  // detect only what changed, shoot on a settled board
+  board_detector_.setPalette(true);
+  board_detector_.setGate(true);
+  board_detector_.setIncremental(true);
+}
+
+Pipeline::~Pipeline()
+{
+  stop();
+}
+
+void Pipeline::setLookahead(bool enable)
+{
+  use_lookahead_ = enable;
+}
+
+void Pipeline::setRecord(std::string const& directory)
+{
+  record_ = directory;
+}
+
+void Pipeline::start(cv::Rect const& game_rect)
+{
+  stop();
+  game_rect_ = game_rect;
+  // nothing in common with the last game
+  board_detector_.reset();
+  running_ = true;
+  capture_thread_ = std::thread(&Pipeline::captureLoop, this);
+  worker_thread_ = std::thread(&Pipeline::workerLoop, this);
+  actuator_thread_ = std::thread(&Pipeline::actuatorLoop, this);
+  if(!record_.empty())
+    record_thread_ = std::thread(&Pipeline::recordLoop, this);
+}
+
+void Pipeline::stop()
+{
+  running_ = false;
+  if(capture_thread_.joinable())
+    capture_thread_.join();
+  if(worker_thread_.joinable())
+    worker_thread_.join();
+  if(actuator_thread_.joinable())
+    actuator_thread_.join();
+  if(record_thread_.joinable())
+    record_thread_.join();
+
+  // nothing of this game for the next one (no stale shot)
+  Frame frame;
+  while(frames_.pop(frame));
+  Shot shot;
+  while(shots_.pop(shot));
+  cv::Mat debug;
+  while(debug_.pop(debug));
+  // but the record is complete
+  cv::Mat image;
+  while(records_.pop(image))
+    save(image);
+}
+
+bool Pipeline::popDebug(cv::Mat & frame)
+{
+  return debug_.pop(frame);
+}
+
+Pipeline::Stats Pipeline::stats() const
+{
+  Stats stats;
+  stats.capture = capture_.snapshot();
+  stats.detect = detect_.snapshot();
+  stats.solve = solve_.snapshot();
+  stats.act = act_.snapshot();
+  stats.latency = latency_.snapshot();
+  stats.record = record_time_.snapshot();
+  stats.frames = depth(frames_.size(), frames_.highWater(), frames_.capacity());
+  stats.shots = depth(shots_.size(), shots_.highWater(), shots_.capacity());
+  stats.records = depth(records_.size(), records_.highWater(), records_.capacity());
+  stats.dropped = dropped_.load();
+  stats.unrecorded = unrecorded_.load();
+  stats.cache_hits = cache_hits_.load();
+  stats.cache_misses = cache_misses_.load();
+  stats.reused = reused_.load();
+  stats.updated = updated_.load();
+  stats.moving = moving_.load();
+  return stats;
+}
+
+void Pipeline::captureLoop()
+{
+  while(running_)
+  {
+    // only grab when the worker can take it, the frame stays fresh
+    if(frames_.size() >= frames_.capacity())
+    {
+      idle(kIdle);
+      continue;
+    }
+    Frame frame;
+    frame.time = Clock::now();
+    // the raw image lives in the shared memory segment, keep a copy
+    frame.image = capture_device_.captureRaw(game_rect_).clone();
+    capture_.add(frame.time, Clock::now());
+    frames_.push(frame);
+  }
+}
+
+void Pipeline::workerLoop()
+{
+  while(running_)
+  {
+    Frame frame;
+    if(!frames_.pop(frame))
+    {
+      idle(kIdle);
+      continue;
+    }
+    if(!record_.empty() && frame.image.data)
+    {
+      // the raw frame is BGRX, and its own copy is safe from the debug drawing
+      cv::Mat image;
+      cv::cvtColor(frame.image, image, CV_BGRA2BGR);
+      if(!records_.push(image))
+        unrecorded_++;
+    }
+
+    Clock::time_point start = Clock::now();
+    bool found = frame.image.data && board_detector_.run(frame.image, board_);
+    Clock::time_point detected = Clock::now();
+    detect_.add(start, detected);
+    if(!found)
+    {
+      // the board is lost, let the caller look for it
+      running_ = false;
+      break;
+    }
+    if(board_detector_.reused())
+      reused_++;
+    if(board_detector_.updated())
+      updated_++;
+    // the last shot is still moving, its result is not known yet
+    if(!board_detector_.settled())
+    {
+      moving_++;
+      continue;
+    }
+
+    // take a decision !
+    Solver::Solution solution;
+    if(use_lookahead_)
+    {
+      solution = lookahead_.run(board_);
+      cache_hits_ = lookahead_.decisions().hits();
+      cache_misses_ = lookahead_.decisions().misses();
+    }
+    else
+    {
+      solution = solver_.run(board_);
+      cache_hits_ = solver_.cache().hits();
+      cache_misses_ = solver_.cache().misses();
+    }
+    solve_.add(detected, Clock::now());
+
+    Shot shot;
+    shot.angle = solution.angle;
+    shot.time = frame.time;
+    shot.target.x = game_rect_.x + board_.player.point.x + 100 * std::cos(solution.angle);
+    shot.target.y = game_rect_.y + board_.player.point.y + 100 * std::sin(solution.angle);
+    if(shots_.push(shot))
+      board_detector_.expectChange();
+    else
+      dropped_++;
+
+    if(debug_.size() < debug_.capacity())
+    {
+      cv::Mat debug = frame.image;
+      board_.drawBall(debug);
+      solver_.draw(debug, solution, board_);
+      debug_.push(debug);
+    }
+  }
+}
+
+void Pipeline::actuatorLoop()
+{
+  while(running_)
+  {
+    Shot shot;
+    if(!shots_.pop(shot))
+    {
+      idle(kIdle);
+      continue;
+    }
+    Clock::time_point start = Clock::now();
+    actuator_device_.mouseMoveAndClick(shot.target.x, shot.target.y);
+    usleep(10000);
+    actuator_device_.click();
+    Clock::time_point end = Clock::now();
+    act_.add(start, end);
+    latency_.add(shot.time, end);
+  }
+}
+
+void Pipeline::recordLoop()
+{
+  while(running_)
+  {
+    cv::Mat image;
+    if(!records_.pop(image))
+    {
+      idle(kIdle);
+      continue;
+    }
+    Clock::time_point start = Clock::now();
+    save(image);
+    record_time_.add(start, Clock::now());
+  }
+}
+
+void Pipeline::save(cv::Mat const& image)
+{
+  std::stringstream name;
+  name << record_ << "/" << recorded_++ << ".png";
+  cv::imwrite(name.str(), image);
+}
+
+std::ostream & operator<<(std::ostream & os, Pipeline::Stats const& stats)
+{
+  os << "pipeline :" << std::endl;
+  print(os, "capture", stats.capture);
+  print(os, "detect", stats.detect);
+  print(os, "solve", stats.solve);
+  print(os, "act", stats.act);
+  print(os, "latency", stats.latency);
+  if(stats.record.count)
+    print(os, "record", stats.record);
+  os << "  frames queue " << stats.frames.current << "/" << stats.frames.capacity
+     << " (high " << stats.frames.high << ")" << std::endl;
+  os << "  shots queue  " << stats.shots.current << "/" << stats.shots.capacity
+     << " (high " << stats.shots.high << ", dropped " << stats.dropped << ")" << std::endl;
+  if(stats.record.count || stats.unrecorded)
+    os << "  record queue " << stats.records.current << "/" << stats.records.capacity
+       << " (high " << stats.records.high << ", unrecorded " << stats.unrecorded << ")" << std::endl;
+  os << "  frames       " << stats.reused << " reused, " << stats.updated << " updated, " << stats.moving << " moving" << std::endl;
+  os << "  cache        " << stats.cache_hits << " hits, " << stats.cache_misses << " misses" << std::endl;
+  return os;
+}
+
+}
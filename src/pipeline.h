@@ -0,0 +1,221 @@
+/////////////////////////////////////////////////////////////////////////
+/// BouncingBallsSolver
+/// Copyright (C) 2014 Jérôme Béchu
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////
+
+#ifndef BBS_PIPELINE_H
+#define BBS_PIPELINE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <thread>
+
+#include "display_device.h"
+#include "detect_board.h"
+#include "lookahead.h"
+#include "solver.h"
+#include "spsc_queue.h"
+#include "stage_counter.h"
+
+namespace bbs
+{
+
+////////////////////////////////////////////////////////////
+/// @brief play the game with one thread per stage :
+///      - capture : grab the game area
+///      - worker : detect the board and solve it
+///      - actuator : move the mouse and click
+///      - recorder : save the frames (only with setRecord)
+///      the next frame is analysed while the previous shot
+///      is still in flight, but a shot is only decided once
+///      the board is settled
+////////////////////////////////////////////////////////////
+class Pipeline
+{
+public:
+  ///! depth of a queue between two stages
+  struct Depth
+  {
+    Depth() : current(0), high(0), capacity(0) {}
+
+    std::size_t current;
+    std::size_t high;
+    std::size_t capacity;
+  };
+
+  ///! snapshot of the pipeline activity
+  struct Stats
+  {
+    Stats() : dropped(0), unrecorded(0), cache_hits(0), cache_misses(0), reused(0), updated(0), moving(0) {}
+
+    Counter capture;
+    Counter detect;
+    Counter solve;
+    Counter act;
+    ///! from the capture of a frame to the click
+    Counter latency;
+    Counter record;
+    Depth frames;
+    Depth shots;
+    Depth records;
+    ///! solutions computed while the actuator was busy
+    uint64_t dropped;
+    ///! frames not saved, the recorder was too late
+    uint64_t unrecorded;
+    ///! boards found (or not) in the decisions cache
+    uint64_t cache_hits;
+    uint64_t cache_misses;
+    ///! frames without detection (no change)
+    uint64_t reused;
+    ///! frames whose board was only edited
+    uint64_t updated;
+    ///! frames not solved, the board was still moving
+    uint64_t moving;
+  };
+
+  Pipeline();
+  ~Pipeline();
+
+  ////////////////////////////////////////////////////////////
+  /// @brief start to play on the game area (screen coordinates)
+  ////////////////////////////////////////////////////////////
+  void start(cv::Rect const& game_rect);
+
+  ////////////////////////////////////////////////////////////
+  /// @brief search several shots ahead instead of the greedy
+  ///        choice (call before start)
+  ////////////////////////////////////////////////////////////
+  void setLookahead(bool enable);
+
+  ////////////////////////////////////////////////////////////
+  /// @brief save every captured frame as <directory>/N.png,
+  ///        for a replay (empty : no record, call before start)
+  ////////////////////////////////////////////////////////////
+  void setRecord(std::string const& directory);
+
+  ////////////////////////////////////////////////////////////
+  /// @brief stop and join all threads, empty the queues
+  ////////////////////////////////////////////////////////////
+  void stop();
+
+  ////////////////////////////////////////////////////////////
+  /// @brief false once the board is lost (or after stop)
+  ////////////////////////////////////////////////////////////
+  bool running() const;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief last analysed frame with the board/solution drawn
+  ////////////////////////////////////////////////////////////
+  bool popDebug(cv::Mat & frame);
+
+  Stats stats() const;
+
+private:
+  typedef Counter::Clock Clock;
+
+  ///! a captured game area
+  struct Frame
+  {
+    cv::Mat image;
+    Clock::time_point time;
+  };
+
+  ///! a shoot to apply
+  struct Shot
+  {
+    Shot() : angle(0) {}
+
+    cv::Point target;
+    float angle;
+    Clock::time_point time;
+  };
+
+  ///! number of frames waiting for the worker
+  constexpr static int kFrameQueue = 2;
+  ///! number of shots waiting for the actuator
+  constexpr static int kShotQueue = 1;
+  ///! number of debug frames waiting for the display
+  constexpr static int kDebugQueue = 2;
+  ///! number of frames waiting to be saved
+  constexpr static int kRecordQueue = 16;
+  ///! sleep when a stage has nothing to do (microseconds)
+  constexpr static int kIdle = 200;
+
+  void captureLoop();
+  void workerLoop();
+  void actuatorLoop();
+  void recordLoop();
+  ///! write a frame as <record_>/N.png
+  void save(cv::Mat const& image);
+
+  ///! the game area
+  cv::Rect game_rect_;
+  ///! the threads are alive ?
+  std::atomic<bool> running_;
+
+  ///! each thread owns its X11 connection
+  DisplayDevice capture_device_;
+  DisplayDevice actuator_device_;
+
+  ///! only used by the worker
+  DetectBoard board_detector_;
+  Solver solver_;
+  Lookahead lookahead_;
+  bool use_lookahead_;
+  Board board_;
+  ///! where the frames are saved (empty : nowhere)
+  std::string record_;
+  ///! number of saved frames (only used by the recorder)
+  int recorded_;
+
+  SpscQueue<Frame> frames_;
+  SpscQueue<Shot> shots_;
+  SpscQueue<cv::Mat> debug_;
+  SpscQueue<cv::Mat> records_;
+
+  StageCounter capture_;
+  StageCounter detect_;
+  StageCounter solve_;
+  StageCounter act_;
+  StageCounter latency_;
+  StageCounter record_time_;
+  std::atomic<uint64_t> dropped_;
+  std::atomic<uint64_t> unrecorded_;
+  std::atomic<uint64_t> cache_hits_;
+  std::atomic<uint64_t> cache_misses_;
+  std::atomic<uint64_t> reused_;
+  std::atomic<uint64_t> updated_;
+  std::atomic<uint64_t> moving_;
+
+  std::thread capture_thread_;
+  std::thread worker_thread_;
+  std::thread actuator_thread_;
+  std::thread record_thread_;
+};
+
+std::ostream & operator<<(std::ostream & os, Pipeline::Stats const& stats);
+
+inline bool Pipeline::running() const
+{
+  return running_.load();
+}
+
+}
+
+#endif // BBS_PIPELINE_H
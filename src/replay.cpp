@@ -0,0 +1,139 @@
+/////////////////////////////////////////////////////////////////////////
+/// BouncingBallsSolver
+/// Copyright (C) 2014 Jérôme Béchu
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////
+
+#include <dirent.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+
+#include "replay.h"
+#include "stage_counter.h"
+
+namespace bbs
+{
+
+namespace
+{
+
+typedef Counter::Clock Clock;
+
+///! N.png before M.png when N < M, other names after
+bool before(std::string const& a, std::string const& b)
+{
+  char *end_a, *end_b;
+  long n_a = std::strtol(a.c_str(), &end_a, 10);
+  long n_b = std::strtol(b.c_str(), &end_b, 10);
+  bool number_a = end_a != a.c_str();
+  bool number_b = end_b != b.c_str();
+  if(number_a != number_b)
+    return number_a;
+  if(number_a && n_a != n_b)
+    return n_a < n_b;
+  return a < b;
+}
+
+}
+
+Replay::Replay(std::string const& directory)
+  : directory_(directory)
+  , use_lookahead_(false)
+  , lookahead_(solver_)
+{
+  // the same detection as the live game
+  board_detector_.setPalette(true);
+  board_detector_.setGate(true);
+  board_detector_.setIncremental(true);
+}
+
+void Replay::setLookahead(bool enable)
+{
+  use_lookahead_ = enable;
+}
+
+std::vector<std::string> Replay::frames() const
+{
+  std::vector<std::string> names;
+  DIR *dir = opendir(directory_.c_str());
+  if(!dir)
+    return names;
+  while(dirent *entry = readdir(dir))
+  {
+    std::string name = entry->d_name;
+    if(name.size() > 4 && name.compare(name.size() - 4, 4, ".png") == 0)
+      names.push_back(name);
+  }
+  closedir(dir);
+  std::sort(names.begin(), names.end(), before);
+  return names;
+}
+
+int Replay::run(std::ostream & os)
+{
+  std::vector<std::string> names = frames();
+  Counter read, detect, solve;
+  int lost = 0;
+  int frames = 0;
+  for(auto const& name : names)
+  {
+    Clock::time_point start = Clock::now();
+    cv::Mat frame = cv::imread(directory_ + "/" + name);
+    Clock::time_point loaded = Clock::now();
+    if(frame.empty())
+    {
+      os << name << " : unreadable" << std::endl;
+      continue ;
+    }
+    read.add(start, loaded);
+    frames++;
+
+    bool found = board_detector_.run(frame, board_);
+    Clock::time_point detected = Clock::now();
+    detect.add(loaded, detected);
+    os << name << " : detect " << std::chrono::duration_cast<std::chrono::microseconds>(detected - loaded).count() << "us";
+    if(!found)
+    {
+      // like the live game, the next frame starts again
+      lost++;
+      board_detector_.reset();
+      os << " no board" << std::endl;
+      continue ;
+    }
+    if(board_detector_.reused())
+      os << " (reused)";
+    else if(board_detector_.updated())
+      os << " (updated)";
+
+    Solver::Solution solution = use_lookahead_ ? lookahead_.run(board_) : solver_.run(board_);
+    Clock::time_point solved = Clock::now();
+    solve.add(detected, solved);
+    os << " solve " << std::chrono::duration_cast<std::chrono::microseconds>(solved - detected).count() << "us"
+       << " balls " << board_.count_ball()
+       << " angle " << std::fixed << std::setprecision(3) << solution.angle
+       << " score " << solution.score << std::endl;
+  }
+
+  os << "replay of " << directory_ << " : " << frames << " frames, "
+     << lost << " without board" << std::endl;
+  print(os, "read", read);
+  print(os, "detect", detect);
+  print(os, "solve", solve);
+  return frames;
+}
+
+}
@@ -0,0 +1,73 @@
+/////////////////////////////////////////////////////////////////////////
+/// BouncingBallsSolver
+/// Copyright (C) 2014 Jérôme Béchu
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////
+
+#ifndef BBS_REPLAY_H
+#define BBS_REPLAY_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "detect_board.h"
+#include "lookahead.h"
+#include "solver.h"
+
+namespace bbs
+{
+
+////////////////////////////////////////////////////////////
+/// @brief run the detection and the solver over recorded
+///        frames (N.png in a directory, in the order of N),
+///        without display nor mouse : one line per frame
+///        (timings, decision) and a summary
+////////////////////////////////////////////////////////////
+class Replay
+{
+public:
+  explicit Replay(std::string const& directory);
+
+  ////////////////////////////////////////////////////////////
+  /// @brief search several shots ahead instead of the greedy
+  ///        choice
+  ////////////////////////////////////////////////////////////
+  void setLookahead(bool enable);
+
+  ////////////////////////////////////////////////////////////
+  /// @brief the frames of the directory, in order
+  ////////////////////////////////////////////////////////////
+  std::vector<std::string> frames() const;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief replay all the frames
+  /// @return number of frames read (0 : nothing to replay)
+  ////////////////////////////////////////////////////////////
+  int run(std::ostream & os);
+
+private:
+  std::string directory_;
+  bool use_lookahead_;
+
+  DetectBoard board_detector_;
+  Solver solver_;
+  Lookahead lookahead_;
+  Board board_;
+};
+
+}
+
+#endif // BBS_REPLAY_H
@@ -22,7 +22,44 @@
 namespace bbs
 {
 
+Solver::Solver(unsigned threads)
+  : pool_(threads)
+  , cache_(kCacheSize)
+{
+}
+
+void Solver::setSearch(Search const& search)
+{
+  search_ = search;
+  // the solutions depend on the search
+  cache_.clear();
+}
+
+void Solver::setCacheSize(std::size_t size)
+{
+  cache_.setCapacity(size);
+}
+
 Solver::Solution Solver::run(Board const& board)
+{
+  uint64_t key = board.hash();
+  Solution const* known = cache_.find(key);
+  if(known)
+    return *known;
+
+  Solution solution = solve(board);
+  // a random angle, the next frame tries another one
+  if(solutions_.empty())
+    return solution;
+  // the balls belong to this board only
+  Solution kept = solution;
+  kept.balls.clear();
+  kept.target = 0;
+  cache_.insert(key, kept);
+  return solution;
+}
+
+Solver::Solution Solver::solve(Board const& board)
 {
   discoverSolution(board);
   return takeDecision(board);
@@ -30,14 +67,96 @@ Solver::Solution Solver::run(Board const& board)
 
 void Solver::discoverSolution(Board const& board)
 {
-  cv::Point origin = board.player.point;
   solutions_.clear();
 
-  for(float k=kMinAngle;k<kMaxAngle;k+=kOffsetAngle)
+  // same angles (float accumulation) than the sequential sweep
+  float step = search_.adaptive ? search_.coarse : kOffsetAngle;
+  angles_.clear();
+  for(float k=kMinAngle;k<kMaxAngle;k+=step)
+    angles_.push_back(k);
+  testAngles(board, 0);
+
+  if(search_.adaptive)
+    refineAngles(board);
+
+  order_.resize(angles_.size());
+  for(int i=0;i<order_.size();++i)
+    order_[i] = i;
+  std::sort(order_.begin(), order_.end(),
+            [this](int a, int b){return angles_[a] < angles_[b];});
+
+  for(auto i : order_)
   {
-    Solution solution(k);
-    if(testTrajectory(origin, k, board, solution))
-      solutions_.push_back(solution);
+    if(found_[i])
+      solutions_.push_back(tested_[i]);
+  }
+}
+
+void Solver::testAngles(Board const& board, int first)
+{
+  cv::Point2f origin = board.player.point;
+  tested_.resize(angles_.size());
+  found_.resize(angles_.size());
+
+  // each angle has its own slot, no lock needed
+  pool_.run(angles_.size() - first, [&](int begin, int end)
+  {
+    for(int i=first+begin;i<first+end;++i)
+    {
+      tested_[i] = Solution(angles_[i]);
+      found_[i] = testTrajectory(origin, angles_[i], board, tested_[i]);
+    }
+  });
+}
+
+bool Solver::differ(int a, int b) const
+{
+  if(found_[a] != found_[b])
+    return true;
+  // the shot gives the same result on another ball (or group) :
+  // the decision only looks at the score and the rebounds
+  return found_[a] && (tested_[a].score != tested_[b].score
+                       || tested_[a].rebound != tested_[b].rebound);
+}
+
+void Solver::refineAngles(Board const& board)
+{
+  // intervals between two tested angles (indices in angles_)
+  std::vector<std::pair<int, int> > intervals;
+  std::vector<std::pair<int, int> > next;
+  for(int i=0;i+1<angles_.size();++i)
+  {
+    if(differ(i, i+1))
+      intervals.push_back(std::make_pair(i, i+1));
+  }
+
+  // one level of bisection at a time, tested in parallel
+  while(!intervals.empty() && angles_.size() < search_.budget)
+  {
+    int first = angles_.size();
+    next.clear();
+    for(auto const& interval : intervals)
+    {
+      if(angles_.size() >= search_.budget)
+        break ;
+      float a = angles_[interval.first];
+      float b = angles_[interval.second];
+      if(b - a <= search_.fine)
+        continue ;
+      angles_.push_back((a + b) / 2);
+      next.push_back(interval);
+    }
+    testAngles(board, first);
+
+    intervals.clear();
+    for(int i=0;i<next.size();++i)
+    {
+      int middle = first + i;
+      if(differ(next[i].first, middle))
+        intervals.push_back(std::make_pair(next[i].first, middle));
+      if(differ(middle, next[i].second))
+        intervals.push_back(std::make_pair(middle, next[i].second));
+    }
   }
 }
 
@@ -113,101 +232,124 @@ Solver::Solution Solver::takeDecision(Board const& board)
   return endTheGame(board);
 }
 
-// check for ball collision every positons each offset on a line
+// first ball hit on a segment of the shot
 bool Solver::collision(const Board &board,
-                       cv::Point const& origin,
+                       cv::Point2f const& origin,
+                       cv::Point2f const& direction,
+                       float length,
                        Solver::Solution & solution,
-                       float angle,
-                       cv::Point & result)
+                       cv::Point2f & result)
 {
-  int x = 0;
-  cv::Point p(origin.x + (board.radius/2) * x * cos(angle), origin.y + (board.radius/2) * x * sin(angle));
-  while(p.x > 0 && p.y > 0 && p.x < board.width && p.y < board.height)
-  {
-    if(board.find(p, solution.balls))
-    {
-      solution.score = 0;
-
-      for(auto b : solution.balls)
-      {
-        if(b->point.y < solution.y)
-        {
-          solution.y = b->point.y;
-        }
-        if(b->type == board.player.type)
-        {
-          // get the local maximum
-          if(b->score > solution.score)
-            solution.score = b->score;
-        }
-      }
+  float t;
+  Board::Ball *first = board.cast(origin, direction, length, t);
+  if(!first)
+    return false;
 
-      if(solution.y > board.height * 0.8)
-        solution.score = -100;
+  // balls overlapping the place where the shot stops
+  result = origin + direction * t;
+  solution.length += t;
+  board.find(origin + direction * (t + 1), solution.balls);
+  if(std::find(solution.balls.begin(), solution.balls.end(), first) == solution.balls.end())
+    solution.balls.push_back(first);
+  solution.target = first;
 
-      result = p;
-      return true;
+  solution.score = 0;
+  for(auto b : solution.balls)
+  {
+    if(b->point.y < solution.y)
+    {
+      solution.y = b->point.y;
+    }
+    if(b->type == board.player.type)
+    {
+      // get the local maximum
+      if(b->score > solution.score)
+        solution.score = b->score;
     }
-    p.x = origin.x + (board.radius/2) * x * std::cos(angle);
-    p.y = origin.y + (board.radius/2) * x * std::sin(angle);
-    x++;
   }
-  return false;
+
+  if(solution.y > board.height * 0.8)
+    solution.score = -100;
+
+  return true;
 }
 
 // test a particular trajectory (angle)
-bool Solver::testTrajectory(cv::Point const& origin, float angle, const Board &board, Solver::Solution & solution, cv::Mat *game)
+// the walls are unfolded : the shot is a straight line in the mirrored
+// boards, the k-th wall is reached after first + (k-1) * period
+bool Solver::testTrajectory(cv::Point2f const& origin, float angle, const Board &board, Solver::Solution & solution, cv::Mat *game)
 {
   if(origin.x < 0 || origin.y < 0 || origin.x > board.width || origin.y > board.height)
     return false;
-  if(solution.rebound > 1)
-    return false;
 
-  cv::Point limit;
-  cv::Point dest(origin.x + board.radius * cos(angle),
-                 origin.y + board.radius * sin(angle));
+  // the center of the shot stays between these two lines
+  double left = board.radius + 1;
+  double right = board.width - board.radius - 1;
+  double dx = std::cos(static_cast<double>(angle));
+  double dy = std::sin(static_cast<double>(angle));
 
-  bool tobe_continued = false;
-  if(dest.x <= origin.x)
-  {
-    tobe_continued = intersection(cv::Point(board.radius+1, 0),
-                                  cv::Point(board.radius+1, board.height),
-                                  origin, dest, limit);
-  }
-  else
+  // distance to the top (or the bottom) of the board
+  double top = std::numeric_limits<double>::max();
+  if(dy < 0)
+    top = -origin.y / dy;
+  if(dy > 0)
+    top = (board.height - origin.y) / dy;
+
+  // distance to the first wall, then between two walls
+  double first = top;
+  double period = top;
+  if(std::fabs(dx) > 1e-6)
   {
-    tobe_continued = intersection(cv::Point(board.width - board.radius - 1, 0),
-                                  cv::Point(board.width - board.radius - 1, board.height),
-                                  origin, dest, limit);
+    first = std::max(0.0, dx < 0 ? (left - origin.x) / dx : (right - origin.x) / dx);
+    period = (right - left) / std::fabs(dx);
   }
-  if(game)
-    cv::line(*game, origin, limit, cv::Scalar(255, 255, 255), 1);
-  cv::Point p;
-  if(collision(board, origin, solution, angle, p))
+
+  double begin = 0;
+  double end = std::min(first, top);
+  for(int rebound=0;rebound<=search_.rebounds;++rebound)
   {
+    // the segment starts on the wall of the previous rebound
+    double x = origin.x;
+    if(rebound > 0)
+      x = (dx < 0) == (rebound % 2 == 1) ? left : right;
+    double sign = rebound % 2 == 1 ? -1 : 1;
+    cv::Point2f start(x, origin.y + dy * begin);
+    cv::Point2f direction(dx * sign, dy);
+    cv::Point2f limit = start + direction * static_cast<float>(end - begin);
+
     if(game)
+      cv::line(*game, start, limit, cv::Scalar(255, 255, 255), 1);
+
+    solution.rebound = rebound;
+    solution.length = begin;
+    cv::Point2f p;
+    if(collision(board, start, direction, end - begin, solution, p))
     {
-      cv::circle(*game, p, board.radius, cv::Scalar(255, 25, 5), 2);
-      std::stringstream ss;
-      ss << solution.score;
-      cv::putText(*game, ss.str(), cv::Point(p.x-5, p.y+5), cv::FONT_HERSHEY_PLAIN, 1, cv::Scalar(255, 255, 255));
+      solution.hit = p;
+      if(game)
+      {
+        cv::circle(*game, p, board.radius, cv::Scalar(255, 25, 5), 2);
+        std::stringstream ss;
+        ss << solution.score;
+        cv::putText(*game, ss.str(), cv::Point(p.x-5, p.y+5), cv::FONT_HERSHEY_PLAIN, 1, cv::Scalar(255, 255, 255));
+      }
+      return true;
     }
-    return true;
-  }
-  if(tobe_continued)
-  {
-    angle = std::atan2(origin.y-limit.y, origin.x-limit.x);
-    angle = M_PI*2 - angle;
 
-    solution.rebound ++;
-    return testTrajectory(limit, angle, board, solution, game);
+    // out of the board before the next wall
+    if(end >= top)
+      break ;
+    begin = end;
+    end = std::min(end + period, top);
   }
+  solution.rebound = 0;
+  solution.length = 0;
   return false;
 }
 
 void Solver::draw(cv::Mat &game, Solution const& solution, const Board &board)
 {
-  cv::Point origin = board.player.point;
+  cv::Point2f origin = board.player.point;
   Solution s;
   testTrajectory(origin, solution.angle, board, s, &game);
 }
@@ -20,6 +20,8 @@
 #define BBS_SOLVER_H
 
 #include "board.h"
+#include "lru_cache.h"
+#include "thread_pool.h"
 
 namespace bbs
 {
@@ -33,11 +35,13 @@ class Solver
 {
 public:
 
-  ///! an effective solution
+  ///! an effective solution (from the cache : no balls, no target)
   struct Solution
   {
     Solution(float angle=0)
-      : rebound(0)
+      : target(0)
+      , rebound(0)
+      , length(0)
       , angle(angle)
       , score(-1)
       , y(std::numeric_limits<int>::max())
@@ -46,8 +50,14 @@ public:
 
     ///! this is the list of balls concerned by this solution
     Board::Ball::PtrList balls;
+    ///! the first ball hit
+    Board::Ball *target;
     ///! how many rebound have to use for this solution ?
     int rebound;
+    ///! where the shot stops (center of the shot ball)
+    cv::Point2f hit;
+    ///! distance travelled until the hit, rebounds included
+    float length;
     ///! what is the angle
     float angle;
     ///! what it the score
@@ -56,11 +66,70 @@ public:
     int y;
   };
 
+  ///! how the angles are explored
+  struct Search
+  {
+    Search()
+      : adaptive(false)
+      , coarse(0.05)
+      , fine(0.0008)
+      , budget(400)
+      , rebounds(1)
+    {
+    }
+
+    ///! false : every kOffsetAngle, true : coarse to fine
+    bool adaptive;
+    ///! step of the first sweep (adaptive only)
+    float coarse;
+    ///! stop refining an interval below this width
+    float fine;
+    ///! maximum number of tested angles (adaptive only)
+    std::size_t budget;
+    ///! maximum number of rebounds on the side walls
+    int rebounds;
+  };
+
+  ////////////////////////////////////////////////////////////
+  /// @brief threads used to test the angles (0 : all the cores)
+  ////////////////////////////////////////////////////////////
+  explicit Solver(unsigned threads = 0);
+
+  ////////////////////////////////////////////////////////////
+  /// @brief change the way angles are explored
+  ////////////////////////////////////////////////////////////
+  void setSearch(Search const& search);
+  Search const& search() const;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief number of angles tested by the last run
+  ////////////////////////////////////////////////////////////
+  int evaluated() const;
+
   ////////////////////////////////////////////////////////////
   /// @brief list solutions, and choose one
+  ///        a board already seen (same hash) reuses its choice
+  ///        (but not a random angle, when nothing is found)
   ////////////////////////////////////////////////////////////
   Solution run(Board const& board);
 
+  ////////////////////////////////////////////////////////////
+  /// @brief same as run, without the cache
+  ////////////////////////////////////////////////////////////
+  Solution solve(Board const& board);
+
+  ////////////////////////////////////////////////////////////
+  /// @brief solutions found by the last solve (sorted by angle)
+  ///        a cache hit of run does not change them
+  ////////////////////////////////////////////////////////////
+  std::vector<Solution> const& solutions() const;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief number of boards remembered by run (0 : no cache)
+  ////////////////////////////////////////////////////////////
+  void setCacheSize(std::size_t size);
+  LruCache<uint64_t, Solution> const& cache() const;
+
   ////////////////////////////////////////////////////////////
   /// @brief draw the solution on the picture ** debug **
   ////////////////////////////////////////////////////////////
@@ -73,22 +142,45 @@ private:
   constexpr static float kMaxAngle = -0.2;
   ///! what is the offset ?
   constexpr static float kOffsetAngle = 0.01;
+  ///! boards remembered by default
+  static const int kCacheSize = 64;
 
   ////////////////////////////////////////////////////////////
   /// @brief test a particular trajectory
+  ///        every rebound is a segment between the two wall
+  ///        lines, computed in closed form (no recursion)
   ////////////////////////////////////////////////////////////
-  bool testTrajectory(cv::Point const& origin, float angle, const Board &board, Solver::Solution & solution, cv::Mat *game=0);
+  bool testTrajectory(cv::Point2f const& origin, float angle, const Board &board, Solver::Solution & solution, cv::Mat *game=0);
 
   ////////////////////////////////////////////////////////////
-  /// @brief test a collision with balls from board
+  /// @brief test a collision with balls from board on a segment
+  ///        (exact intersection of the shot with every ball)
   ////////////////////////////////////////////////////////////
-  bool collision(Board const& board, cv::Point const& origin, Solver::Solution & solution, float angle, cv::Point & result);
+  bool collision(Board const& board, cv::Point2f const& origin, cv::Point2f const& direction, float length, Solver::Solution & solution, cv::Point2f & result);
 
   ////////////////////////////////////////////////////////////
   /// @brief list possible solution
+  ///        angles are tested in parallel, the solutions keep
+  ///        the order of the angles
   ////////////////////////////////////////////////////////////
   void discoverSolution(Board const& board);
 
+  ////////////////////////////////////////////////////////////
+  /// @brief test angles_ from first to the end (in parallel)
+  ////////////////////////////////////////////////////////////
+  void testAngles(Board const& board, int first);
+
+  ////////////////////////////////////////////////////////////
+  /// @brief bisect the intervals where the score or the
+  ///        rebound count changes
+  ////////////////////////////////////////////////////////////
+  void refineAngles(Board const& board);
+
+  ////////////////////////////////////////////////////////////
+  /// @brief true if two tested angles don't hit the same way
+  ////////////////////////////////////////////////////////////
+  bool differ(int a, int b) const;
+
   Solver::Solution onlyStrike(Board const& board);
 
   Solver::Solution endTheGame(Board const& board);
@@ -100,8 +192,43 @@ private:
 
   ///! internal list of solution
   std::vector<Solution> solutions_;
+
+  ///! threads for the angle sweep
+  ThreadPool pool_;
+  ///! angles to test, and the result of each one
+  std::vector<float> angles_;
+  std::vector<Solution> tested_;
+  std::vector<char> found_;
+  ///! indices of angles_ sorted by angle
+  std::vector<int> order_;
+
+  ///! current search settings
+  Search search_;
+
+  ///! board hash -> chosen solution
+  LruCache<uint64_t, Solution> cache_;
 };
 
+inline Solver::Search const& Solver::search() const
+{
+  return search_;
+}
+
+inline std::vector<Solver::Solution> const& Solver::solutions() const
+{
+  return solutions_;
+}
+
+inline LruCache<uint64_t, Solver::Solution> const& Solver::cache() const
+{
+  return cache_;
+}
+
+inline int Solver::evaluated() const
+{
+  return angles_.size();
+}
+
 }
 
 #endif // BB_SOLVER_H
@@ -0,0 +1,139 @@
+/////////////////////////////////////////////////////////////////////////
+/// BouncingBallsSolver
+/// Copyright (C) 2014 Jérôme Béchu
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////
+
+#ifndef BBS_SPSC_QUEUE_H
+#define BBS_SPSC_QUEUE_H
+
+#include <atomic>
+#include <vector>
+
+namespace bbs
+{
+
+////////////////////////////////////////////////////////////
+/// @brief bounded lock free queue, one producer thread and
+///        one consumer thread only
+////////////////////////////////////////////////////////////
+template<typename T>
+class SpscQueue
+{
+public:
+  explicit SpscQueue(std::size_t capacity);
+
+  ////////////////////////////////////////////////////////////
+  /// @brief add an item, return false if the queue is full
+  ////////////////////////////////////////////////////////////
+  bool push(T const& item);
+
+  ////////////////////////////////////////////////////////////
+  /// @brief take the oldest item, return false if empty
+  ////////////////////////////////////////////////////////////
+  bool pop(T & item);
+
+  ////////////////////////////////////////////////////////////
+  /// @brief number of items waiting (approximative)
+  ////////////////////////////////////////////////////////////
+  std::size_t size() const;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief highest number of items seen waiting
+  ////////////////////////////////////////////////////////////
+  std::size_t highWater() const;
+
+  std::size_t capacity() const;
+
+private:
+  std::size_t next(std::size_t index) const;
+
+  ///! one slot is always left empty to distinguish full and empty
+  std::vector<T> items_;
+  ///! next item to pop (owned by the consumer)
+  alignas(64) std::atomic<std::size_t> head_;
+  ///! next free slot (owned by the producer)
+  alignas(64) std::atomic<std::size_t> tail_;
+  ///! updated by the producer
+  std::atomic<std::size_t> high_water_;
+};
+
+template<typename T>
+SpscQueue<T>::SpscQueue(std::size_t capacity)
+  : items_(capacity + 1)
+  , head_(0)
+  , tail_(0)
+  , high_water_(0)
+{
+}
+
+template<typename T>
+bool SpscQueue<T>::push(T const& item)
+{
+  std::size_t tail = tail_.load(std::memory_order_relaxed);
+  std::size_t after = next(tail);
+  if(after == head_.load(std::memory_order_acquire))
+    return false;
+  items_[tail] = item;
+  tail_.store(after, std::memory_order_release);
+
+  std::size_t depth = size();
+  if(depth > high_water_.load(std::memory_order_relaxed))
+    high_water_.store(depth, std::memory_order_relaxed);
+  return true;
+}
+
+template<typename T>
+bool SpscQueue<T>::pop(T & item)
+{
+  std::size_t head = head_.load(std::memory_order_relaxed);
+  if(head == tail_.load(std::memory_order_acquire))
+    return false;
+  item = items_[head];
+  // don't keep a reference on the payload (cv::Mat buffers)
+  items_[head] = T();
+  head_.store(next(head), std::memory_order_release);
+  return true;
+}
+
+template<typename T>
+std::size_t SpscQueue<T>::size() const
+{
+  std::size_t head = head_.load(std::memory_order_acquire);
+  std::size_t tail = tail_.load(std::memory_order_acquire);
+  return tail >= head ? tail - head : tail + items_.size() - head;
+}
+
+template<typename T>
+std::size_t SpscQueue<T>::highWater() const
+{
+  return high_water_.load(std::memory_order_relaxed);
+}
+
+template<typename T>
+std::size_t SpscQueue<T>::capacity() const
+{
+  return items_.size() - 1;
+}
+
+template<typename T>
+std::size_t SpscQueue<T>::next(std::size_t index) const
+{
+  return index + 1 == items_.size() ? 0 : index + 1;
+}
+
+}
+
+#endif // BBS_SPSC_QUEUE_H
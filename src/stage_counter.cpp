@@ -0,0 +1,78 @@
+/////////////////////////////////////////////////////////////////////////
+/// BouncingBallsSolver
+/// Copyright (C) 2014 Jérôme Béchu
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////
+
+#include <iomanip>
+
+#include "stage_counter.h"
+
+namespace bbs
+{
+
+namespace
+{
+
+uint64_t microseconds(Counter::Clock::time_point const& start, Counter::Clock::time_point const& end)
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+}
+
+}
+
+void Counter::add(Clock::time_point const& start, Clock::time_point const& end)
+{
+  uint64_t us = microseconds(start, end);
+  count++;
+  total += us;
+  if(us > max)
+    max = us;
+}
+
+StageCounter::StageCounter()
+  : count_(0)
+  , total_(0)
+  , max_(0)
+{
+}
+
+void StageCounter::add(Clock::time_point const& start, Clock::time_point const& end)
+{
+  uint64_t us = microseconds(start, end);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  total_.fetch_add(us, std::memory_order_relaxed);
+  if(us > max_.load(std::memory_order_relaxed))
+    max_.store(us, std::memory_order_relaxed);
+}
+
+Counter StageCounter::snapshot() const
+{
+  Counter counter;
+  counter.count = count_.load(std::memory_order_relaxed);
+  counter.total = total_.load(std::memory_order_relaxed);
+  counter.max = max_.load(std::memory_order_relaxed);
+  return counter;
+}
+
+void print(std::ostream & os, char const* name, Counter const& counter)
+{
+  os << "  " << std::setw(8) << std::left << name << std::right
+     << " n=" << std::setw(6) << counter.count
+     << " mean=" << std::setw(8) << std::fixed << std::setprecision(1) << counter.mean() << "us"
+     << " max=" << counter.max << "us" << std::endl;
+}
+
+}
@@ -0,0 +1,77 @@
+/////////////////////////////////////////////////////////////////////////
+/// BouncingBallsSolver
+/// Copyright (C) 2014 Jérôme Béchu
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////
+
+#ifndef BBS_STAGE_COUNTER_H
+#define BBS_STAGE_COUNTER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+namespace bbs
+{
+
+////////////////////////////////////////////////////////////
+/// @brief timings of a stage (microseconds), the same for
+///        the live game and the replay
+////////////////////////////////////////////////////////////
+struct Counter
+{
+  typedef std::chrono::steady_clock Clock;
+
+  Counter() : count(0), total(0), max(0) {}
+  double mean() const { return count ? double(total) / count : 0; }
+
+  ////////////////////////////////////////////////////////////
+  /// @brief one more run of the stage
+  ////////////////////////////////////////////////////////////
+  void add(Clock::time_point const& start, Clock::time_point const& end);
+
+  uint64_t count;
+  uint64_t total;
+  uint64_t max;
+};
+
+////////////////////////////////////////////////////////////
+/// @brief thread safe version of Counter, written by one
+///        thread, read by any
+////////////////////////////////////////////////////////////
+class StageCounter
+{
+public:
+  typedef Counter::Clock Clock;
+
+  StageCounter();
+  void add(Clock::time_point const& start, Clock::time_point const& end);
+  Counter snapshot() const;
+
+private:
+  std::atomic<uint64_t> count_;
+  std::atomic<uint64_t> total_;
+  std::atomic<uint64_t> max_;
+};
+
+////////////////////////////////////////////////////////////
+/// @brief one line : name, count, mean and max
+////////////////////////////////////////////////////////////
+void print(std::ostream & os, char const* name, Counter const& counter);
+
+}
+
+#endif // BBS_STAGE_COUNTER_H
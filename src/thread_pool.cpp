@@ -0,0 +1,113 @@
+/////////////////////////////////////////////////////////////////////////
+/// BouncingBallsSolver
+/// Copyright (C) 2014 Jérôme Béchu
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+
+#include "thread_pool.h"
+
+namespace bbs
+{
+
+ThreadPool::ThreadPool(unsigned threads)
+  : job_(0)
+  , count_(0)
+  , grain_(1)
+  , next_(0)
+  , busy_(0)
+  , generation_(0)
+  , stop_(false)
+{
+  if(threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  for(unsigned i=1;i<threads;++i)
+    threads_.push_back(std::thread(&ThreadPool::work, this));
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  for(auto & thread : threads_)
+    thread.join();
+}
+
+void ThreadPool::run(int count, Job const& job)
+{
+  if(count <= 0)
+    return ;
+  if(threads_.empty() || count == 1)
+  {
+    job(0, count);
+    return ;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    job_ = &job;
+    count_ = count;
+    // a few chunks per thread to balance uneven work
+    grain_ = std::max(1, count / int(size() * 4));
+    next_ = 0;
+    busy_ = threads_.size();
+    ++generation_;
+  }
+  wake_.notify_all();
+
+  help();
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_.wait(lock, [this]{ return busy_ == 0; });
+  job_ = 0;
+}
+
+void ThreadPool::work()
+{
+  unsigned seen = 0;
+  while(true)
+  {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      wake_.wait(lock, [&]{ return stop_ || generation_ != seen; });
+      if(stop_)
+        return ;
+      seen = generation_;
+    }
+
+    help();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if(--busy_ == 0)
+      done_.notify_one();
+  }
+}
+
+void ThreadPool::help()
+{
+  while(true)
+  {
+    int begin = next_.fetch_add(grain_);
+    if(begin >= count_)
+      break ;
+    (*job_)(begin, std::min(count_, begin + grain_));
+  }
+}
+
+}
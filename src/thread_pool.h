@@ -0,0 +1,94 @@
+/////////////////////////////////////////////////////////////////////////
+/// BouncingBallsSolver
+/// Copyright (C) 2014 Jérôme Béchu
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////
+
+#ifndef BBS_THREAD_POOL_H
+#define BBS_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace bbs
+{
+
+////////////////////////////////////////////////////////////
+/// @brief a fixed set of threads sharing loops by chunks
+///        the calling thread works too
+////////////////////////////////////////////////////////////
+class ThreadPool
+{
+public:
+  ///! process the indices [begin, end[
+  typedef std::function<void(int begin, int end)> Job;
+
+  ////////////////////////////////////////////////////////////
+  /// @brief threads = 0 use all the cores
+  ////////////////////////////////////////////////////////////
+  explicit ThreadPool(unsigned threads = 0);
+  ~ThreadPool();
+
+  ////////////////////////////////////////////////////////////
+  /// @brief split [0, count[ between the threads, wait the end
+  ////////////////////////////////////////////////////////////
+  void run(int count, Job const& job);
+
+  ////////////////////////////////////////////////////////////
+  /// @brief number of threads, the caller included
+  ////////////////////////////////////////////////////////////
+  unsigned size() const;
+
+private:
+  ThreadPool(ThreadPool const&);
+  ThreadPool & operator=(ThreadPool const&);
+
+  void work();
+
+  ////////////////////////////////////////////////////////////
+  /// @brief take chunks of the current job until the end
+  ////////////////////////////////////////////////////////////
+  void help();
+
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+
+  ///! the current job, written under the mutex
+  Job const* job_;
+  int count_;
+  int grain_;
+  ///! next index to process
+  std::atomic<int> next_;
+  ///! workers still on the current job
+  int busy_;
+  ///! incremented for each job
+  unsigned generation_;
+  bool stop_;
+};
+
+inline unsigned ThreadPool::size() const
+{
+  return threads_.size() + 1;
+}
+
+}
+
+#endif // BBS_THREAD_POOL_H
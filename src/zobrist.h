@@ -0,0 +1,71 @@
+/////////////////////////////////////////////////////////////////////////
+/// BouncingBallsSolver
+/// Copyright (C) 2014 Jérôme Béchu
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////
+
+#ifndef BBS_ZOBRIST_H
+#define BBS_ZOBRIST_H
+
+#include <cstdint>
+
+namespace bbs
+{
+
+////////////////////////////////////////////////////////////
+/// @brief Zobrist hashing : a board hash is the xor of one
+///        key per (cell, colour), so adding or removing a
+///        ball is one xor
+///        the keys are not stored, they come from splitmix64
+///        of the (cell, colour) index
+////////////////////////////////////////////////////////////
+namespace zobrist
+{
+
+///! tags of the keys which are not a ball
+enum Tag
+{
+  kPlayer = 1,
+  kEndGame,
+  kGeometry,
+  kDepth
+};
+
+///! splitmix64 of a value
+inline uint64_t mix(uint64_t x)
+{
+  x += 0x9e3779b97f4a7c15ull;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  return x ^ (x >> 31);
+}
+
+///! a ball of a colour on a cell (cell < 2^48)
+inline uint64_t key(uint64_t cell, unsigned char colour)
+{
+  return mix((cell << 8) | colour);
+}
+
+///! anything else : the tag keeps the keys apart
+inline uint64_t tagged(Tag tag, uint64_t value)
+{
+  return mix((uint64_t(tag) << 56) ^ (value << 8) ^ 0xff);
+}
+
+}
+
+}
+
+#endif // BBS_ZOBRIST_H
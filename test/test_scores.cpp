@@ -0,0 +1,183 @@
+/////////////////////////////////////////////////////////////////////////
+/// BouncingBallsSolver
+/// Copyright (C) 2014 Jérôme Béchu
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+#include "board_generator.h"
+#include "detect_board.h"
+#include "replay.h"
+
+////////////////////////////////////////////////////////////
+/// @brief Board::rearange against the first recursive
+///        implementation (falling balls, groups, scores) on
+///        generated boards, and on the recorded frames of the
+///        directory named by BBS_TEST_FRAMES
+///        the reference is slow, the boards stay small
+////////////////////////////////////////////////////////////
+
+namespace
+{
+
+typedef bbs::Board::Ball Ball;
+typedef bbs::Board::Ball::PtrList PtrList;
+
+// a path to the top row
+bool hasTopParent(bbs::Board const& board, Ball *ball, PtrList & previous)
+{
+  if(!ball) return false;
+  if(ball->point.y == board.y_first_row())
+    return true;
+  if(std::find(previous.begin(), previous.end(), ball) != previous.end())
+    return false;
+  previous.push_back(ball);
+  return    hasTopParent(board, ball->up_left, previous)
+      || hasTopParent(board, ball->up_right, previous)
+      || hasTopParent(board, ball->left, previous)
+      || hasTopParent(board, ball->right, previous)
+      || hasTopParent(board, ball->down_left, previous)
+      || hasTopParent(board, ball->down_right, previous);
+}
+
+// the ball stays if the group is popped
+bool allParent(bbs::Board const& board, PtrList const& sameballs, PtrList & done, Ball *ball,
+               std::vector<bool> const& disable, Ball const* first)
+{
+  if(!ball) return true;
+  if(disable[ball - first]) return false;
+  if(std::find(sameballs.begin(), sameballs.end(), ball) != sameballs.end())
+    return true;
+  if(std::find(done.begin(), done.end(), ball) != done.end())
+    return true;
+  done.push_back(ball);
+  if(ball->point.y == board.y_first_row())
+    return false;
+  return allParent(board, sameballs, done, ball->up_left, disable, first)
+      && allParent(board, sameballs, done, ball->up_right, disable, first)
+      && allParent(board, sameballs, done, ball->left, disable, first)
+      && allParent(board, sameballs, done, ball->right, disable, first)
+      && allParent(board, sameballs, done, ball->down_left, disable, first)
+      && allParent(board, sameballs, done, ball->down_right, disable, first);
+}
+
+////////////////////////////////////////////////////////////
+/// @brief number of balls whose disable flag, count or score
+///        differ from the reference
+////////////////////////////////////////////////////////////
+int compare(bbs::Board const& board)
+{
+  Ball::List const& all = board.all_balls();
+  if(all.empty())
+    return 0;
+  Ball *first = const_cast<Ball *>(&all[0]);
+
+  std::vector<bool> disable(all.size());
+  for(int i=0;i<all.size();++i)
+  {
+    PtrList previous;
+    disable[i] = !hasTopParent(board, first + i, previous);
+  }
+
+  // same type neighbors, enabled ones only
+  std::vector<int> group(all.size(), -1);
+  std::vector<PtrList> groups;
+  for(int i=0;i<all.size();++i)
+  {
+    if(disable[i] || group[i] >= 0)
+      continue ;
+    group[i] = groups.size();
+    groups.push_back(PtrList(1, first + i));
+    for(int k=0;k<groups.back().size();++k)
+    {
+      Ball *b = groups.back()[k];
+      Ball *n[6] = {b->up_left, b->up_right, b->left, b->right, b->down_left, b->down_right};
+      for(auto p : n)
+      {
+        if(!p || disable[p - first] || group[p - first] >= 0 || p->type != b->type)
+          continue ;
+        group[p - first] = group[i];
+        groups.back().push_back(p);
+      }
+    }
+  }
+
+  int bad = 0;
+  for(int i=0;i<all.size();++i)
+  {
+    int count = 0;
+    int score = 0;
+    if(!disable[i])
+    {
+      PtrList const& same = groups[group[i]];
+      count = same.size();
+      for(int j=0;j<all.size();++j)
+      {
+        PtrList done;
+        score += allParent(board, same, done, first + j, disable, first);
+      }
+    }
+    if(all[i].disable != disable[i] || (!disable[i] && all[i].count != count) || all[i].score != score)
+    {
+      std::cerr << "ball (" << all[i].point.x << ", " << all[i].point.y << ") : disable "
+                << all[i].disable << "/" << disable[i] << ", count " << all[i].count << "/" << count
+                << ", score " << all[i].score << "/" << score << std::endl;
+      bad++;
+    }
+  }
+  return bad;
+}
+
+}
+
+int main()
+{
+  int boards = 0;
+  int bad = 0;
+  for(unsigned seed=0;seed<300;++seed)
+  {
+    bbs::BoardGenerator::Settings settings;
+    settings.rows = 1 + seed % 6;
+    settings.cols = 8;
+    settings.colours = 2 + seed % 3;
+    settings.fill = 0.6f + 0.1f * (seed % 4);
+    settings.seed = seed;
+    bbs::Board board;
+    bbs::BoardGenerator(settings).generate(board);
+    bad += compare(board);
+    boards++;
+  }
+
+  char const* directory = std::getenv("BBS_TEST_FRAMES");
+  if(directory)
+  {
+    bbs::DetectBoard detector;
+    for(auto const& name : bbs::Replay(directory).frames())
+    {
+      bbs::Board board;
+      detector.reset();
+      if(!detector.run(cv::imread(std::string(directory) + "/" + name), board))
+        continue ;
+      bad += compare(board);
+      boards++;
+    }
+  }
+
+  std::cout << boards << " boards, " << bad << " balls differ" << std::endl;
+  return bad == 0 ? 0 : 1;
+}